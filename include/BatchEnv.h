@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Map.h"
+#include "Random.h"
+#include <memory>
+#include <vector>
+
+/*
+A batch of games stepped together for an external learning loop.
+
+The games hold no Snake or GameSession objects. Their state is kept in
+one array a field, indexed by the game, and step() moves every snake in
+one call with the same collision rules as Snake::move(). A game that
+ends is restarted inside the same step, and its map is reused in place
+so that the views returned by getCells() stay valid.
+
+Each game begins with a snake of length 3 and one food. It ends
+when the snake dies, fills the map, or goes the number of playable cells
+without eating.
+*/
+class BatchEnv {
+public:
+    typedef Map::size_type size_type;
+    typedef Map::index_type index_type;
+    typedef float reward_type;
+
+    /*
+    Initialize and reset all the games.
+
+    @param envCnt the number of games
+    @param rowCnt the rows of every map, including the boundaries
+    @param colCnt the columns of every map, including the boundaries
+    @param seed game k draws its random choices from seed + k
+    @param hardMode whether to add the walls of the hard mode
+    @throw std::range_error if there is no game, the map is smaller than
+           4*4, or the hard mode is on and the map isn't 20*20
+    */
+    BatchEnv(const size_type envCnt, const size_type rowCnt, const size_type colCnt,
+             const Random::seed_type seed, const bool hardMode = false);
+    ~BatchEnv();
+
+    BatchEnv(const BatchEnv &) = delete;
+    BatchEnv& operator=(const BatchEnv &) = delete;
+
+    /*
+    Move every snake one cell. A game that ends is reset before return,
+    so the cells show the new game while getRewards() and getDones()
+    still report the move that ended the old one.
+
+    @param actions one direction a game, NONE keeps the current one
+    */
+    void step(const Direc *actions);
+
+    /*
+    Restart every game. The random choices go on from where they were,
+    so this doesn't replay the first games.
+    */
+    void resetAll();
+
+    /*
+    Start game k from a given snake and food instead of a random place,
+    e.g. to continue a game played by a GameSession.
+
+    @param k the game
+    @param body the snake cells from the head to the tail, at least 2
+    @param direc the direction the snake is heading
+    @param food the food cell
+    @throw std::range_error if the cells aren't distinct empty cells,
+           the body isn't a chain of neighbours or the food is on it.
+           Game k is reset at random then.
+    */
+    void setGame(const size_type k, const std::vector<index_type> &body, const Direc direc,
+                 const index_type food);
+
+    size_type size() const;
+    size_type getRowCount() const;
+    size_type getColCount() const;
+
+    /*
+    Get a read-only view of the cell types of game k, see Map::getCells().
+    The view is updated in place by step().
+    */
+    const Map::cell_type* getCells(const size_type k) const;
+
+    /*
+    Get the results of the last step, one entry a game: +1 for eating,
+    -1 for dying and 0 otherwise; whether the game ended.
+    */
+    const reward_type* getRewards() const;
+    const unsigned char* getDones() const;
+
+    /*
+    Get the heads, lengths and directions of the current snakes, and
+    the food cells.
+    */
+    const index_type* getHeads() const;
+    const size_type* getLengths() const;
+    const Direc* getDirections() const;
+    const index_type* getFoods() const;
+
+private:
+    size_type envCnt;
+    size_type capacity;  // Body slots a game, the playable cells
+
+    std::vector<std::shared_ptr<Map>> maps;
+    std::vector<Random> rngs;
+
+    // Bodies as ring buffers, game k in [k * capacity, (k + 1) * capacity)
+    std::vector<index_type> bodies;
+    std::vector<size_type> fronts;  // Slot of the head
+
+    std::vector<index_type> heads;
+    std::vector<size_type> lengths;
+    std::vector<Direc> direcs;
+    std::vector<index_type> foods;
+    std::vector<size_type> hungers;
+    std::vector<reward_type> rewards;
+    std::vector<unsigned char> dones;
+
+    /*
+    Clear the snake and the food of game k and place new ones.
+
+    @throw std::runtime_error if there is no room for the snake
+    */
+    void reset(const size_type k);
+
+    /*
+    Clear the snake and the food of game k.
+    */
+    void clear(const size_type k);
+
+    /*
+    Get the body cell i steps behind the head of game k.
+    */
+    index_type& bodyAt(const size_type k, const size_type i);
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Pos.h"
+#include <vector>
+#include <cstdint>
+
+/*
+A grid of bits, one bit per cell.
+Every row is stored in its own run of 64-bit words, so the cells of a
+row can be processed 64 at a time with shift-and-mask operations.
+*/
+class Bitboard {
+public:
+    typedef uint64_t word_type;
+    typedef std::vector<word_type>::size_type size_type;
+
+    static const size_type WORD_BITS = 64;
+
+    Bitboard();
+    Bitboard(const size_type &rowCnt_, const size_type &colCnt_);
+    ~Bitboard();
+
+    /*
+    Resize the board. All bits are cleared.
+    */
+    void resize(const size_type &rowCnt_, const size_type &colCnt_);
+
+    /*
+    Get or set the bit of a given position.
+    */
+    bool test(const Pos &p) const;
+    void set(const Pos &p, const bool b);
+
+    /*
+    Clear all bits.
+    */
+    void clear();
+
+    /*
+    Get the amount of set bits.
+    */
+    size_type count() const;
+
+    /*
+    Find all set bits connected to a source position by expanding
+    a frontier row by row until nothing changes. Each sweep over the
+    rows fills a corridor in one direction, so a winding region takes
+    a sweep per turn and a breadth-first search may be cheaper.
+
+    @param from the source position, whose bit need not be set
+    @param reach the result will be stored in this field. The source
+                 position is always included.
+    @param maxSweeps the sweeps to stop after, 0 for no limit
+    @return false if the fill stopped at maxSweeps before the whole
+            region was found, in which case reach holds a part of it
+    */
+    bool floodFill(const Pos &from, Bitboard &reach, const size_type maxSweeps = 0) const;
+
+private:
+    size_type rowCnt = 0;
+    size_type colCnt = 0;
+    size_type rowWords = 0;  // Words per row
+    std::vector<word_type> bits;
+
+    const word_type* row(const size_type &i) const;
+    word_type* row(const size_type &i);
+
+    /*
+    Expand the seeds of a row along its set bits in both directions.
+
+    @param seed the seeds, updated in place
+    @param mask the bits the seeds may expand into
+    @return true if any seed bit is added
+    */
+    bool fillRow(word_type *seed, const word_type *mask) const;
+};
@@ -1,12 +1,13 @@
 #pragma once
 
-#include "Snake.h"
+#include "GameSession.h"
 #include "Console.h"
 #include <thread>
 #include <mutex>
 
 /*
-Game controller.
+Game controller. Plays one game session on the console, with threads
+to draw it, read the keyboard and move the snake.
 */
 class GameCtrl {
 public:
@@ -54,6 +55,8 @@ public:
     void setEnableAI(const bool &enable);
     void setRunTest(const bool &b);
     void setRecordMovements(const bool &b);
+    void setCycleCacheDir(const std::string &dir);
+    void setHeadless(const bool &b);
 
     /*
     Run the game.
@@ -67,20 +70,20 @@ public:
 private:
     Map::size_type mapRowCnt = 10;
     Map::size_type mapColCnt = 10;
-    long int score = 0;
-    long int scoreFood = 100;
-    long int scoreTime = -1;
     long moveInterval = 30;
     bool enableAI = true;
     bool runTest = false;
     bool recordMovements = false;
+    bool headless = false;
+    std::string cycleCacheDir;
 
     bool pause = false;  // Field to implement pause/resume game
 
     std::chrono::steady_clock::duration thinkingTime;
 
-    Snake snake;
-    std::shared_ptr<Map> map;
+    GameSession session;
+    std::shared_ptr<Map> map;  // The map of the session
+    SearchContext testSearch;  // Search fields shown by the test program
 
     bool threadWork = true;      // Thread running switcher
     std::thread gameThread;      // Thread to draw the map
@@ -102,19 +105,28 @@ private:
     */
     void sleepByFPS() const;
 
+    /*
+    Play a whole game with the AI on the calling thread, without drawing
+    or sleeping, and print the moves and time taken.
+
+    @return the exit status of the program.
+    */
+    int runHeadless();
+
     /*
     Initialize.
     */
     void init();
-    void initMap();
-    void initSnakes();
+    void initSession();
     void initFiles();
     void teardown();
 
     /*
     Move the snake and check if game is over. (thread-safe)
+
+    @param decide whether the AI chooses the direction first
     */
-    void moveSnake(Snake &s);
+    void moveSnake(const bool decide);
 
     /*
     Write the map content to movement file.
@@ -129,7 +141,7 @@ private:
 
     /*
     Thread contents for gameThread
-    Draw the game elements, add food, etc
+    Draw the game elements
     */
     void game();
 
@@ -141,10 +153,10 @@ private:
     /*
     Draw a point in testing program.
 
-    @param p the point to draw
+    @param i the index of the cell to draw
     @param the color of the point
     */
-    void drawTestPoint(const Point &p, const ConsoleColor &consoleColor) const;
+    void drawTestPoint(const Map::index_type &i, const ConsoleColor &consoleColor) const;
 
     /*
     Callback for keyboard thread.
@@ -155,10 +167,9 @@ private:
     /*
     Execute keyboard move instruction.
 
-    @param s the snake to move
     @param d the direction to move
     */
-    void keyboardMove(Snake &s, const Direc &d);
+    void keyboardMove(const Direc &d);
 
     /*
     Callback for food thread.
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Snake.h"
+#include <chrono>
+#include <memory>
+#include <string>
+
+/*
+State of one game: the map, the snake on it and the score. A session
+uses no globals, so a process can run any number of them at once as
+long as each one is driven by one thread at a time.
+*/
+class GameSession {
+public:
+    typedef std::chrono::steady_clock::duration duration_type;
+
+    GameSession();
+    ~GameSession();
+
+    /*
+    Game configuration setters, applied by the next init().
+    */
+    void setMapRow(const Map::size_type &n);
+    void setMapCol(const Map::size_type &n);
+    void setHardMode(const bool &b);
+
+    /*
+    Set the directory of the hamilton cycle cache, see
+    Snake::setCycleCacheDir(). A cycle loaded from it isn't the one the
+    seed would generate and takes no random draws, so with a cache the
+    same seed plays a different game depending on what the cache holds.
+    */
+    void setCycleCacheDir(const std::string &dir);
+
+    /*
+    Set the number of threads building the hamilton cycle, see
+    Snake::setCycleThreadCount(). Sessions run in parallel should
+    use 1 so that they don't share out the cores again.
+    */
+    void setCycleThreadCount(const unsigned &n);
+
+    /*
+    Set the seed of all the random choices of the game, so that init()
+    always starts the same game and the AI plays it the same way.
+    This holds only without a cycle cache, see setCycleCacheDir().
+    Default is a seed taken from the clock at construction.
+    */
+    void setSeed(const Random::seed_type &s);
+    Random::seed_type getSeed() const;
+
+    /*
+    Start a new game: create the map, the snake and the first food.
+
+    @throw std::range_error if the map is smaller than 4*4, or the
+           hard mode is on and the map isn't 20*20
+    */
+    void init();
+
+    /*
+    Create the map only, for the test programs.
+
+    @throw std::range_error as init()
+    */
+    void initMap();
+
+    /*
+    Play one move and add food if the snake ate it. Does nothing once
+    the game is over.
+
+    @param decide whether the AI chooses the direction first, otherwise
+                  the snake keeps the direction it has been given
+    */
+    void tick(const bool decide = true);
+
+    /*
+    Let the AI play until the game is over.
+
+    @param maxMoves the moves after which to give up, 0 for no limit
+    */
+    void play(const long long maxMoves = 0);
+
+    /*
+    Check whether the game is over, and how.
+    */
+    bool isOver() const;
+    bool isWin() const;
+    bool isDead() const;
+
+    long getScore() const;
+    long long getMoveCount() const;
+
+    /*
+    Get the time the AI took to choose the last move.
+    */
+    duration_type getThinkingTime() const;
+
+    std::shared_ptr<Map> getMap() const;
+    Random& getRandom();
+    Snake& getSnake();
+    const Snake& getSnake() const;
+
+    /*
+    Add the extra walls of the hard mode to a 20*20 map.
+
+    @throw std::range_error if the map isn't 20*20
+    */
+    static void addHardWalls(Map &map);
+
+private:
+    Map::size_type mapRowCnt = 10;
+    Map::size_type mapColCnt = 10;
+    bool hardMode = false;
+    std::string cycleCacheDir;
+    unsigned cycleThreadCnt = 0;
+    Random::seed_type seed;
+
+    Random rng;
+    std::shared_ptr<Map> map;
+    Snake snake;
+
+    long score = 0;
+    long scoreFood = 100;
+    long scoreTime = -1;
+    long long moveCnt = 0;
+    duration_type thinkingTime = duration_type::zero();
+
+    /*
+    Create the snake on the map.
+    */
+    void initSnake();
+
+    /*
+    Add food to the map if there is none and the map isn't full.
+    */
+    void createFoodIfNeed();
+};
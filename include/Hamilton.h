@@ -3,21 +3,188 @@
 #include "Map.h"
 #include "Pos.h"
 
+#include <array>
+#include <cstdint>
+#include <string>
 #include <vector>
 #include <iostream>
 
+/*
+Hamilton cycle covering all empty cells of a map.
+*/
 class Hamilton {
 public:
     typedef uint location_type;
+    typedef Map::index_type index_type;
 
-    void generate(Map& map);
-    Pos next(const Pos& pos) const;
-    location_type location(const Pos& anchor, const Pos& a) const;
+    /*
+    Generate a random cycle. The cycle is built around a random spanning
+    tree of the 2x2 blocks of the map, split over threads on large maps,
+    and the cells of blocks cut by walls are merged into it cell by
+    cell. If that fails it is grown by Map::findMaxPath(), which may fail too,
+    so a caller retrying should run checkFeasible() once beforehand.
+
+    @param rng the generator of all random choices, so the same seed
+               gives the same cycle
+    @throw std::runtime_error if the cycle doesn't cover the map
+    */
+    void generate(const Map& map, SearchContext& ctx, Random& rng);
+
+    /*
+    Reject in linear time a map whose empty cells can't have a covering
+    cycle. The checks are necessary but not sufficient: a cycle steps
+    between the two colours of the grid in turn, enters and leaves every
+    cell through different neighbours, and survives the removal of any
+    one cell, so the empty cells must be balanced in colour, have two
+    empty neighbours each, be connected and have no articulation cell.
+
+    @throw std::runtime_error describing the first violation found
+    */
+    void checkFeasible(const Map& map) const;
+
+    /*
+    Set the number of threads building the cycle of a large map.
+    Default is 0, which uses one thread a core.
+    */
+    void setThreadCount(const unsigned n);
+    /*
+    Get the file name of the cached cycle of a map. It is made of the map
+    size and a hash of the cells the cycle can't enter, so maps with the
+    same walls share it.
+    */
+    static std::string cacheName(const Map& map);
+
+    /*
+    Load a cycle written by save(). The file is memory mapped where the
+    platform supports it and read otherwise.
+
+    @return false if the file is missing, is for another map or doesn't
+            hold a cycle covering the map, in which case nothing changes
+    */
+    bool load(const Map& map, const std::string& filename);
+
+    /*
+    Write the cycle generated for a map. Only the steps are stored, two
+    bits per cell; the sequence is numbered again on load. The file is
+    written under a temporary name in the same directory and renamed
+    over the target, so concurrent writers or a crash never leave a
+    partly written cache behind.
+
+    @return false if the file can't be written
+    */
+    bool save(const Map& map, const std::string& filename) const;
+
+    /*
+    Shorten the way from the head of a snake to the food along the cycle.
+    A piece of the cycle before the food is cut off at a 2x2 square the
+    cycle crosses both ways, and spliced back in at another such square
+    between the food and the tail. The cells from the tail to the head
+    keep their steps and numbers, so the snake stays ordered along the
+    cycle, and only the cells between the two squares are numbered again.
+
+    @param head the head of the snake
+    @param tail the tail of the snake
+    @param food the food cell
+    @return the number of cells moved behind the food
+    */
+    location_type reroute(const index_type& head, const index_type& tail, const index_type& food);
+
+    index_type next(const index_type& i) const;
+
+    /*
+    Get the place of a cell along the cycle counted from an anchor cell,
+    namely its sequence number plus the cycle length if it comes before
+    the anchor. The places of the cells from the anchor on increase by
+    one a step, across the end of the sequence too.
+    */
+    location_type location(const index_type& anchor, const index_type& a) const;
 
     friend std::ostream& operator<<(std::ostream& os, const Hamilton& h);
 
 private:
-    std::vector<std::vector<Direc> > steps;
-    std::vector<std::vector<location_type> > sequence;
+    // Maps smaller than this are built on the calling thread only
+    static const size_t PARALLEL_MIN_CELLS;
+
+    // Block rows of a tile built by one thread on a large map
+    static const size_t TILE_BLOCK_ROWS;
+
+    // Splices a reroute() may make, each scanning the way to the tail
+    static const int MAX_REROUTE_ROUNDS;
+
+    // Leading bytes of a cache file, followed by the packed steps
+    struct CacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t rows;
+        uint32_t cols;
+        uint64_t layout;
+    };
+
+    // Step direction and sequence number of each cell, row-major
+    std::vector<unsigned char> steps;
+    std::vector<location_type> sequence;
     location_type maxSequence;
+
+    // Scratch of reroute(), indexed by the place after the head
+    std::vector<index_type> handleAt;
+    std::vector<location_type> nearHandle;
+
+    // Map width and index offsets of the neighbours, indexed by Direc
+    Map::size_type colCnt;
+    std::array<Map::offset_type, 5> adjOffset;
+
+    unsigned threadCnt = 0;
+
+    /*
+    Size the stores to a map.
+    */
+    void reset(const Map& map);
+
+    /*
+    Make a cell step to an adjacent one.
+    */
+    void linkTo(const index_type& from, const index_type& to);
+
+    /*
+    Hash the size of a map and the cells the cycle can't enter.
+    */
+    static uint64_t layoutHash(const Map& map);
+
+    /*
+    Unpack the steps of a cache file and check they form a covering cycle.
+    */
+    bool loadFrom(const Map& map, const unsigned char* data, const size_t size);
+
+    /*
+    Build the cycle around a random spanning tree of the 2x2 blocks.
+    Every block starts as a small cycle, and each tree edge joins the
+    cycles of its two blocks by replacing their facing sides with two
+    crossing steps. Tiles of block rows pick their spanning forests in
+    parallel, which are then joined across the tile borders.
+
+    The empty cells of blocks cut by walls, and of an odd last row or
+    column, are covered by small cycles found by augmenting paths,
+    which may rewire nearby blocks too. These cycles and the trees are
+    then merged at the squares where two of them run side by side.
+
+    @return false if the empty cells have no cover by cycles or the
+            cycles can't be merged, in which case nothing is built
+    */
+    bool generateFromBlocks(const Map& map, Random& rng);
+
+    /*
+    Grow the cycle as a longest path between two adjacent cells.
+    */
+    void generateBySearch(const Map& map, SearchContext& ctx, Random& rng);
+
+    /*
+    Number the cells along the cycle starting at a given cell. On large
+    maps the cycle is cut into pieces numbered in parallel.
+    */
+    void numberFrom(const index_type& start);
+
+    /*
+    Get the number of threads to work on a map with a given cell count.
+    */
+    unsigned workerCount(const size_t cellCnt) const;
 };
@@ -1,66 +1,139 @@
 #pragma once
 
 #include "Point.h"
-#include <list>
+#include "SearchContext.h"
+#include "Bitboard.h"
+#include "Path.h"
+#include "Random.h"
+#include <array>
 
 /*
 Game map.
+Cell types are stored row-major in a single packed byte array and
+cells are addressed by their index in it. The neighbours of a cell are
+found through a per-map offset table, so the hot loops never convert
+indices to coordinates. The search algorithms keep their fields in a
+SearchContext and never modify the map, so several searches can run on
+one map at once.
 */
 class Map {
 public:
-    typedef std::vector<std::vector<Point>> content_type;
+    typedef unsigned char cell_type;
+    typedef std::vector<cell_type> content_type;
     typedef content_type::size_type size_type;
     typedef Point::Type point_type;
+    typedef Point::index_type index_type;
+    typedef int32_t offset_type;
+
+    /*
+    Algorithms to find a shortest path.
+    */
+    enum SearchAlgo {
+        BFS,    // Breadth-first search
+        ASTAR,  // A* search guided by the Manhatten distance
+        BIBFS,  // Breadth-first search from both ends
+        TIMED   // Breadth-first search also entering the blocked cells
+                // that are freed in time, see SearchContext::setFreeTime()
+    };
 
     Map(const size_type &rowCnt_, const size_type &colCnt_);
     ~Map();
 
     /*
-    Get the point object of a given position on the map.
+    Convert between a position and its row-major cell index.
+    */
+    index_type toIndex(const Pos &p) const;
+    Pos toPos(const index_type &i) const;
+
+    /*
+    Get the index offset of the adjacent cell in a given direction.
+    The offset of NONE is 0.
+    */
+    offset_type getAdjOffset(const Direc &d) const;
+
+    /*
+    Get the adjacent cell in a given direction.
+    Notice that the boundary cells have no neighbours outside the map,
+    which is fine since they are always walls.
+    */
+    index_type getAdj(const index_type &i, const Direc &d) const;
+
+    /*
+    Get the direction from one cell to another.
+
+    @return the direction or NONE if the cells are not adjacent
+    */
+    Direc getDirection(const index_type &from, const index_type &to) const;
+
+    /*
+    Get or set the type of a given cell on the map.
     */
-    Point& getPoint(const Pos &p);
-    const Point& getPoint(const Pos &p) const;
+    point_type getType(const index_type &i) const;
+    point_type getType(const Pos &p) const;
+    void setType(const index_type &i, const point_type &t);
+    void setType(const Pos &p, const point_type &t);
 
     /*
-    Check whether the position is inside the map,
+    Check whether the cell is inside the map,
     namely not on the boundary.
     */
+    bool isInside(const index_type &i) const;
     bool isInside(const Pos &p) const;
 
     /*
-    Check the type at one position.
+    Check the type of one cell.
+    Cells on the boundary are always walls, so no bounds are checked.
     */
-    bool isHead(const Pos &p) const;
-    bool isTail(const Pos &p) const;
-    bool isEmpty(const Pos &p) const;
+    bool isHead(const index_type &i) const;
+    bool isTail(const index_type &i) const;
+    bool isEmpty(const index_type &i) const;
 
     /*
-    Check whether the position is safe.
+    Check whether the cell is safe.
     */
-    bool isSafe(const Pos &p) const;
+    bool isSafe(const index_type &i) const;
 
     /*
-    Check whether the map is filled with snake body.
+    Check whether the map is filled with snake body. (constant time)
     */
     bool isAllBody() const;
 
+    /*
+    Get the amount of cells of a given type. (constant time)
+    */
+    size_type getTypeCount(const point_type &t) const;
+
     /*
     Get all empty positions.
 
     @param res the result will be stored in this field.
     */
     void getEmptyPoints(std::vector<Pos> &res) const;
-    Pos randomEmpty() const;
+
+    /*
+    Get the amount of empty positions. (constant time)
+    */
+    size_type getEmptyCount() const;
+
+    /*
+    Get an empty cell uniformly at random. (constant time)
+
+    @param rng the generator to draw from
+    @return the cell or Point::NO_INDEX if there is no empty cell
+    */
+    index_type randomEmpty(Random &rng) const;
 
     /*
     Create food at an empty position randomly.
+
+    @param rng the generator to draw from
     */
-    void createRandFood();
+    void createRandFood(Random &rng);
 
     /*
-    Create food at a given position.
+    Create food at a given cell.
     */
-    void createFood(const Pos &pos);
+    void createFood(const index_type &i);
 
     /*
     Remove food from the map.
@@ -73,9 +146,9 @@ public:
     bool hasFood() const;
 
     /*
-    Get food position.
+    Get the food cell, Point::NO_INDEX if there is no food.
     */
-    const Pos& getFood() const;
+    index_type getFood() const;
 
     /*
     Get the amount of rows.
@@ -88,9 +161,58 @@ public:
     size_type getColCount() const;
 
     /*
-    Set whether to show the details of the search algorithms.
+    Get the cell types, row-major with getRowCount() * getColCount()
+    entries. The buffer stays at the same address for the lifetime of
+    the map, so the pointer can be kept as a live read-only view.
+    */
+    const cell_type* getCells() const;
+
+    /*
+    Set whether to keep a bitboard of the free positions, which lets
+    findMinPath() reject unreachable goals before searching.
+    */
+    void setUseBitboard(const bool &b);
+
+    /*
+    Set whether to keep a field of the distances from every cell to the
+    food through free cells. The field is rebuilt when food is created
+    and repaired by setType() when a cell becomes free or blocked, which
+    only touches the cells whose distances change.
+    */
+    void setUseFoodDist(const bool &b);
+    bool isUseFoodDist() const;
+
+    /*
+    Get the distance from a free cell to the food, INF if the food
+    can't be reached or the field isn't kept.
+    */
+    Point::value_type getFoodDist(const index_type &i) const;
+
+    /*
+    Get the first step of a shortest path from a cell to the food by
+    looking up the distance field. (constant time)
+
+    @param from the start cell, which needn't be free
+    @param initDirec the preferred direction among equally short ones
+    @return the direction or NONE if the food can't be reached
+    */
+    Direc getFoodDirec(const index_type &from, const Direc &initDirec) const;
+
+    /*
+    Check whether a cell can reach another one through free
+    cells. Always true if the bitboard isn't used, or if its fill
+    would cost more than the search the check precedes.
+    Notice that only EMPTY points are free, but the goal itself may
+    be of any type.
     */
-    void setShowSearchDetails(const bool &b);
+    bool isReachable(const index_type &from, const index_type &to, SearchContext &ctx) const;
+
+    /*
+    Count the free cells connected to a cell, not including
+    the cell itself. Notice that only EMPTY points are free, so the
+    food splits the region if it's the only link between two parts.
+    */
+    size_type countFreeRegion(const index_type &from, SearchContext &ctx) const;
 
     /*
     Estimate the distance between two positions. (Manhatten distance)
@@ -103,78 +225,205 @@ public:
 
     /*
     Find a shortest path as straight as possible between two positions.
-    Notice that only EMPTY points are searched by the algorithm.
-
-    @param from the start position
-    @param to the end position
+    Notice that only EMPTY points are searched by the algorithm, besides
+    the end cell, which may be of any type.
+    All algorithms but TIMED find paths of the same length, but A* and
+    the bidirectional search usually expand far fewer nodes than the
+    BFS. The amount of expanded nodes is stored in the context.
+    TIMED may find shorter paths through cells that are blocked now,
+    entering each cell no earlier than its free time. The path it
+    returns is feasible but not always the shortest feasible one. Every
+    cell is labelled once with its earliest arrival, so the search never
+    winds through labelled cells to reach a blocked one after its free
+    time; it's only entered later from a neighbour first reached later.
+    Labelling (cell, time) pairs would also have to keep the path off
+    the body it leaves behind, which one BFS can't do.
+
+    @param from the start cell
+    @param to the end cell
     @param initDirec aimming to get a path starting at this direction
+    @param ctx the search fields will be stored in this context
     @param path the result will be stored in this field.
+    @param algo the search algorithm to use
     */
-    void findMinPath(const Pos &from, const Pos &to, const Direc &initDirec, std::list<Direc> &path);
+    void findMinPath(const index_type &from, const index_type &to, const Direc &initDirec,
+                     SearchContext &ctx, Path &path, const SearchAlgo &algo = BFS) const;
 
     /*
     Find a longest path as straight as possible between two positions.
-    Notice that only EMPTY points are searched by the algorithm.
-
-    @param from the start position
-    @param to the end position
+    Notice that only EMPTY points are searched by the algorithm, besides
+    the end cell, which may be of any type.
+    A shortest path is grown by splicing in the shortest detour of
+    every step until no step has one. A pass takes linear time
+    besides the searches for detours longer than two cells.
+
+    @param from the start cell
+    @param to the end cell
     @param initDirec aimming to get a path starting at this direction
+    @param ctx the search fields will be stored in this context
     @param path the result will be stored in this field.
     */
-    void findMaxPath(const Pos &from, const Pos &to, const Direc &initDirec, std::list<Direc> &path);
+    void findMaxPath(const index_type &from, const index_type &to, const Direc &initDirec,
+                     SearchContext &ctx, Path &path) const;
 
 private:
-    content_type content;
+    size_type rowCnt;
+    size_type colCnt;
+
+    content_type content;  // Cell types, row-major
+
+    // Index offsets of the adjacent cells, indexed by Direc
+    std::array<offset_type, 5> adjOffset;
 
-    Pos food = Pos::INVALID;
+    // Indices of all EMPTY cells in no particular order, and the slot
+    // of each cell in that list (NO_SLOT if the cell isn't EMPTY).
+    // Kept in sync by setType().
+    static const index_type NO_SLOT = Point::NO_INDEX;
+    std::vector<index_type> emptyCells;
+    std::vector<index_type> emptySlot;
 
-    bool showSearchDetails = false;
+    // Amount of cells of each type, kept in sync by setType()
+    size_type typeCnt[point_type::TEST_PATH + 1] = {};
 
-    // Interval time when showing searched point
-    static const long detailInterval = 10;
+    // Bitboard of the cells searched by the algorithms, kept in sync
+    // by setType() if it's used
+    bool useBitboard = false;
+    Bitboard freeBits;
+
+    index_type food = Point::NO_INDEX;
+
+    // Distances to the food, kept in sync by setType() if it's used,
+    // and the scratch fields of the repairs
+    bool useFoodDist = false;
+    std::vector<Point::value_type> foodDist;
+    std::vector<index_type> fieldAffected;
+    std::vector<index_type> fieldSeeds;
+    std::vector<index_type> fieldOpen;
+    std::vector<unsigned> fieldMark;
+    unsigned fieldGen = 0;
 
     /*
-    Initialize map content before searching.
+    Add or remove a cell in the empty cell list.
     */
-    void initMin();
-    void initMax();
+    void addEmpty(const index_type &i);
+    void removeEmpty(const index_type &i);
 
     /*
-    Recursive method called in findMaxPath().
+    Check whether a cell type is searched by the algorithms.
     */
-    void findMax(const Pos &curPos, const Direc &curDirec,
-                 const Pos &from, const Pos &to, std::list<Direc> &path);
-    void markPathVisited(const Pos &from, const std::list<Direc> &path);
+    static bool isFreeType(const cell_type &t);
 
     /*
-    Construct the path between two positions.
+    Check whether a cell is on the paths of the food distance field,
+    namely a free cell or the food.
+    */
+    bool isFieldFree(const index_type &i) const;
 
-    @param from the start position
-    @param to the end position
-    @param path the result will be stored in this field.
+    /*
+    Compute the food distance field from scratch.
     */
-    void constructPath(const Pos &from, const Pos &to, std::list<Direc> &path) const;
+    void rebuildFoodDist();
 
     /*
-    Show the details of a searched position.
+    Repair the food distance field after a cell became blocked.
+    The cells whose shortest paths all pass through it are collected
+    layer by layer, then their distances are recomputed from the
+    cells around them in increasing order.
+    */
+    void blockFoodDist(const index_type &c);
 
-    @param p the position
-    @param t the type to be set to the point on the position
+    /*
+    Repair the food distance field after a cell became free.
+    Its distance can only shorten the others, so a breadth-first
+    pass from it is enough.
     */
-    void showPosSearchDetail(const Pos &p, const point_type &t);
+    void unblockFoodDist(const index_type &c);
 
     /*
-    Show a visited position on the map if the field 'showSearchDetails' is true.
+    The breadth-first search of findMinPath() without the
+    reachability check.
 
-    @param n the position of the node
+    @param timed whether a blocked cell can be entered once the path
+                 reaches its free time in the context, checked on
+                 the earliest arrival from each neighbour only
     */
-    void showVisitPosIfNeed(const Pos &n);
+    void searchMinPath(const index_type &from, const index_type &to, const Direc &initDirec,
+                       SearchContext &ctx, Path &path, const bool timed = false) const;
 
     /*
-    Show a solution path on the map if the field 'showSearchDetails' is true.
+    The A* search of findMinPath() without the reachability check.
+    Open nodes are kept in a bucket queue indexed by f = g + h, where
+    f only grows by 0 or 2 along a step. Each bucket is a stack, so
+    the deepest node and the straightest move are expanded first.
+    Cells reopened with a smaller f leave stale entries behind, which
+    are skipped when popped.
+    */
+    void searchAStar(const index_type &from, const index_type &to, const Direc &initDirec,
+                     SearchContext &ctx, Path &path) const;
 
-    @param start the start point
+    /*
+    The bidirectional search of findMinPath() without the reachability
+    check. Whole layers are expanded from the side with the smaller
+    frontier, and the search stops after the first layer that meets
+    the other side, keeping the shortest connection found in it.
+    */
+    void searchBidirectional(const index_type &from, const index_type &to, const Direc &initDirec,
+                             SearchContext &ctx, Path &path) const;
+
+    /*
+    Find the shortest detour of a path step through free cells that
+    aren't visited. The result is the one the breadth-first search
+    would find, but the two-cell detours beside the step are checked
+    directly and the search is skipped if the step has no free
+    neighbours to leave or enter by.
+
+    @param first the start cell of the step, visited
+    @param second the end cell of the step, not visited
+    @param d the direction of the step
+    @param ctx the context holding the visit marks
+    @param detour the result will be stored in this field,
+                  at most one step if there is no detour
+    */
+    void findDetour(const index_type &first, const index_type &second, const Direc &d,
+                    SearchContext &ctx, Path &detour) const;
+
+    /*
+    Check whether a cell has a free neighbour that isn't visited,
+    not counting a given one.
+    */
+    bool hasFreeAdj(const index_type &i, const index_type &except,
+                    const SearchContext &ctx) const;
+
+    /*
+    Get the sweeps a bitboard fill may take before a breadth-first
+    search would be cheaper. A sweep costs about as much as searching
+    one cell per word of the board, so the limit is a share of the
+    empty cells a word.
+    */
+    Bitboard::size_type maxFillSweeps() const;
+
+    /*
+    Mark all cells of a path visited.
+    */
+    void markPathVisited(const index_type &from, const Path &path, SearchContext &ctx) const;
+
+    /*
+    Show a solution path if the search details of the context are shown.
+
+    @param ctx the context showing the details
+    @param from the start cell
     @param path the path to show
     */
-    void showPathIfNeed(const Pos &start, const std::list<Direc> &path);
+    void showPathIfNeed(SearchContext &ctx, const index_type &from, const Path &path) const;
+
+    /*
+    Construct the path between two cells.
+
+    @param from the start cell
+    @param to the end cell
+    @param ctx the context storing the search fields
+    @param path the result will be stored in this field.
+    */
+    void constructPath(const index_type &from, const index_type &to, const SearchContext &ctx,
+                       Path &path) const;
 };
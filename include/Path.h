@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Pos.h"
+#include <vector>
+#include <iterator>
+#include <cstdint>
+
+/*
+A sequence of move directions packed 2 bits per step, namely 32 steps
+in each 64-bit word. A step is never NONE.
+Free space is kept at both ends of the buffer so that steps can be
+added to either end without moving the others, and clearing a path
+keeps its capacity. A path reserved to the map size never allocates.
+*/
+class Path {
+public:
+    typedef uint64_t word_type;
+    typedef std::vector<word_type>::size_type size_type;
+
+    /*
+    Iterator yielding the steps by value.
+    */
+    class const_iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef Direc value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const Direc* pointer;
+        typedef Direc reference;
+
+        const_iterator(const Path *path_, const size_type &i_);
+        Direc operator*() const;
+        const_iterator& operator++();
+        const_iterator operator++(int);
+        friend bool operator==(const const_iterator &a, const const_iterator &b);
+        friend bool operator!=(const const_iterator &a, const const_iterator &b);
+
+    private:
+        const Path *path;
+        size_type i;  // Index in the buffer
+    };
+
+    Path();
+    ~Path();
+
+    /*
+    Make room for n steps at either end.
+    */
+    void reserve(const size_type &n);
+
+    /*
+    Remove all steps. The capacity is kept.
+    */
+    void clear();
+
+    bool empty() const;
+    size_type size() const;
+
+    /*
+    Get a step.
+    */
+    Direc front() const;
+    Direc operator[](const size_type &i) const;
+
+    /*
+    Add a step at the front or at the back.
+    */
+    void push_front(const Direc &d);
+    void push_back(const Direc &d);
+
+    /*
+    Exchange the steps and the buffers of two paths.
+    */
+    void swap(Path &other);
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    friend bool operator==(const Path &a, const Path &b);
+    friend bool operator!=(const Path &a, const Path &b);
+
+private:
+    static const size_type STEP_BITS = 2;
+    static const size_type WORD_STEPS = 32;
+
+    std::vector<word_type> buf;
+    size_type first = 0;  // Index of the first step in buf
+    size_type last = 0;   // Index after the last step in buf
+
+    /*
+    Get the step capacity of the buffer.
+    */
+    size_type capacity() const;
+
+    /*
+    Get or set the step at an index of the buffer.
+    */
+    Direc get(const size_type &k) const;
+    void set(const size_type &k, const Direc &d);
+
+    /*
+    Move n steps inside the buffer. The ranges may overlap.
+    */
+    void move(const size_type &from, const size_type &to, const size_type &n);
+
+    /*
+    Move the steps to the middle of the buffer, growing it if
+    there is less than the given free space at each end.
+    */
+    void recenter(const size_type &space);
+};
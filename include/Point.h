@@ -1,13 +1,20 @@
 #pragma once
 
 #include "Pos.h"
+#include <cstdint>
 
 /*
 Point on the game map.
+The cell type itself is stored by Map in a packed byte array and the
+fields of the graph search algorithms are kept by SearchContext.
+Cells are addressed by their row-major index on the map.
 */
 class Point {
 public:
     typedef int value_type;
+    typedef uint32_t index_type;
+
+    static const index_type NO_INDEX = static_cast<index_type>(-1);
 
     enum Type {
         EMPTY,
@@ -19,27 +26,4 @@ public:
         TEST_VISIT,
         TEST_PATH
     };
-
-    Point();
-    ~Point();
-
-    void setType(Type type_);
-    void setDist(const value_type dist_);
-    void setParent(const Pos &p_);
-    void setPos(const Pos &p_);
-    void setVisit(const bool v);
-    Type getType() const;
-    value_type getDist() const;
-    Pos getParent() const;
-    Pos getPos() const;
-    bool isVisit() const;
-
-private:
-    Type type = EMPTY;
-
-    // Fields for grpah seaching algorithm
-    bool visit = false;
-    value_type dist = INF;
-    Pos parent = Pos::INVALID;
-    Pos pos = Pos::INVALID;
 };
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "Base.h"
-#include <vector>
+#include <array>
 #include <string>
 
 // Move direction
@@ -55,7 +55,7 @@ public:
     /*
     Get all adjacent positions.
     */
-    std::vector<Pos> getAllAdjPos() const;
+    std::array<Pos, 4> getAllAdjPos() const;
 
     /*
     Get the string description of the position.
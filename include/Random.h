@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+Seedable random number generator (xoshiro256**). Every game owns one
+and draws all its random choices from it, so a game is replayed exactly
+from its seed on any platform and thread.
+*/
+class Random {
+public:
+    typedef uint64_t seed_type;
+    typedef uint64_t result_type;
+
+    explicit Random(const seed_type s = 0);
+
+    /*
+    Restart the sequence of a seed.
+    */
+    void seed(const seed_type s);
+
+    /*
+    Get the next 64 random bits.
+    */
+    result_type next();
+
+    /*
+    Return a random number in [0, n), n must be positive.
+    */
+    result_type below(const result_type n);
+
+    /*
+    Randomly rearrange the elements.
+    */
+    template<typename T>
+    void shuffle(std::vector<T> &n) {
+        for (size_t i = 1; i < n.size(); ++i) {
+            auto r = below(i + 1);
+            T tmp = n[i];
+            n[i] = n[r];
+            n[r] = tmp;
+        }
+    }
+
+    /*
+    Get a seed from the clock for a game that needn't be replayed.
+    Seeds taken at the same time still differ.
+    */
+    static seed_type timeSeed();
+
+private:
+    uint64_t state[4];
+};
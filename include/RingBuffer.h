@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vector>
+#include <stdexcept>
+#include <utility>
+
+/*
+A fixed-capacity circular buffer.
+Elements can be added or removed at both ends in constant time
+without any allocation, and are indexed from the front.
+*/
+template<typename T>
+class RingBuffer {
+public:
+    typedef typename std::vector<T>::size_type size_type;
+
+    /*
+    Remove all elements and set the capacity.
+    */
+    void reset(const size_type &capacity_) {
+        buf.assign(capacity_, T());
+        head = cnt = 0;
+    }
+
+    size_type capacity() const {
+        return buf.size();
+    }
+
+    size_type size() const {
+        return cnt;
+    }
+
+    bool empty() const {
+        return cnt == 0;
+    }
+
+    /*
+    Get the i-th element from the front.
+    */
+    T& operator[](const size_type &i) {
+        return buf[wrap(head + i)];
+    }
+
+    const T& operator[](const size_type &i) const {
+        return buf[wrap(head + i)];
+    }
+
+    T& front() {
+        return buf[head];
+    }
+
+    const T& front() const {
+        return buf[head];
+    }
+
+    T& back() {
+        return (*this)[cnt - 1];
+    }
+
+    const T& back() const {
+        return (*this)[cnt - 1];
+    }
+
+    void push_front(const T &t) {
+        checkFull();
+        head = wrap(head + buf.size() - 1);
+        buf[head] = t;
+        ++cnt;
+    }
+
+    void push_back(const T &t) {
+        checkFull();
+        buf[wrap(head + cnt)] = t;
+        ++cnt;
+    }
+
+    void pop_front() {
+        head = wrap(head + 1);
+        --cnt;
+    }
+
+    void pop_back() {
+        --cnt;
+    }
+
+    /*
+    Reverse the order of the elements.
+    */
+    void reverse() {
+        for (size_type i = 0, j = cnt; i + 1 < j; ++i, --j) {
+            std::swap((*this)[i], (*this)[j - 1]);
+        }
+    }
+
+private:
+    std::vector<T> buf;
+    size_type head = 0;  // Index of the front element in buf
+    size_type cnt = 0;
+
+    size_type wrap(const size_type &i) const {
+        return i >= buf.size() ? i - buf.size() : i;
+    }
+
+    void checkFull() const {
+        if (cnt == buf.size()) {
+            throw std::overflow_error("RingBuffer: The buffer is full.");
+        }
+    }
+};
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "Point.h"
+#include "Bitboard.h"
+#include <vector>
+
+/*
+Scratch state of the graph search algorithms on a map.
+Every search works on its own context instead of the map, so several
+searches can run on the same map at the same time.
+
+The distance and visit fields are generation-stamped: a field is only
+valid if its stamp equals the current generation. Resetting all fields
+is a counter bump and a search only touches the cells it reaches.
+*/
+class SearchContext {
+public:
+    typedef std::vector<Point::value_type>::size_type size_type;
+    typedef unsigned stamp_type;
+
+    SearchContext();
+    ~SearchContext();
+
+    /*
+    Fit the context to a map size, including all the scratch buffers,
+    so the searches on the map never allocate. Nothing is done if the
+    size doesn't change.
+    */
+    void resize(const size_type &rowCnt_, const size_type &colCnt_);
+
+    /*
+    Reset the search fields before searching. (constant time)
+    */
+    void initMin();
+    void initMax();
+    void initFreeTime();
+
+    /*
+    Search fields of a given cell.
+    */
+    Point::value_type getDist(const Point::index_type &i) const;
+    void setDist(const Point::index_type &i, const Point::value_type dist_);
+    Point::index_type getParent(const Point::index_type &i) const;
+    void setParent(const Point::index_type &i, const Point::index_type &parent_);
+    bool isVisit(const Point::index_type &i) const;
+    void setVisit(const Point::index_type &i, const bool v);
+
+    /*
+    Search fields of the backward half of a bidirectional search.
+    The parent of a cell is the next cell towards the goal.
+    */
+    Point::value_type getBackDist(const Point::index_type &i) const;
+    void setBackDist(const Point::index_type &i, const Point::value_type dist_);
+    Point::index_type getBackParent(const Point::index_type &i) const;
+    void setBackParent(const Point::index_type &i, const Point::index_type &parent_);
+
+    /*
+    The move from which a blocked cell can be entered, used by the
+    time-aware search. INF if the cell is never freed.
+    */
+    Point::value_type getFreeTime(const Point::index_type &i) const;
+    void setFreeTime(const Point::index_type &i, const Point::value_type t);
+
+    /*
+    Scratch bitboard for the reachability checks.
+    */
+    Bitboard& getReach();
+
+    /*
+    Scratch queue for the breadth-first searches. Its capacity is
+    kept between searches.
+    */
+    std::vector<Point::index_type>& getOpenList();
+    std::vector<Point::index_type>& getBackOpenList();
+
+    /*
+    Scratch bucket queue for the A* search. Every bucket is a stack
+    linked through a shared entry pool, which is sized in resize()
+    for the at most four pushes per cell of one search.
+    clearBuckets() must be called before every search.
+    */
+    void clearBuckets();
+    void pushBucket(const size_type &b, const Point::index_type &i);
+    bool popBucket(const size_type &b, Point::index_type &i);
+    size_type getBucketCount() const;
+
+    /*
+    Get or set the amount of nodes expanded by the last search.
+    */
+    size_type getExpandCount() const;
+    void setExpandCount(const size_type &n);
+
+    /*
+    Set or get whether to show the details of the search algorithms.
+    */
+    void setShowSearchDetails(const bool &b);
+    bool isShowSearchDetails() const;
+
+    /*
+    Get the detail type shown at a cell, namely TEST_VISIT,
+    TEST_PATH or EMPTY if nothing is shown there.
+    */
+    Point::Type getDetail(const Point::index_type &i) const;
+
+    /*
+    Show a visited cell if the field 'showSearchDetails' is true.
+
+    @param i the index of the cell
+    */
+    void showVisitPosIfNeed(const Point::index_type &i);
+
+    /*
+    Show the details of a searched cell. Only valid if the field
+    'showSearchDetails' is true.
+
+    @param i the index of the cell
+    @param t the detail type to be shown on the cell
+    */
+    void showPosSearchDetail(const Point::index_type &i, const Point::Type &t);
+
+private:
+    size_type rowCnt = 0;
+    size_type colCnt = 0;
+
+    // Search fields, row-major
+    std::vector<Point::value_type> dist;
+    std::vector<Point::index_type> parent;
+    std::vector<Point::value_type> backDist;
+    std::vector<Point::index_type> backParent;
+    std::vector<Point::value_type> freeTime;
+
+    // Generation stamps of the fields above, 0 is never valid
+    std::vector<stamp_type> distStamp;
+    std::vector<stamp_type> visitStamp;
+    std::vector<stamp_type> backDistStamp;
+    std::vector<stamp_type> freeTimeStamp;
+    stamp_type distGen = 1;
+    stamp_type visitGen = 1;
+    stamp_type backDistGen = 1;
+    stamp_type freeTimeGen = 1;
+
+    Bitboard reach;
+    std::vector<Point::index_type> openList;
+    std::vector<Point::index_type> backOpenList;
+
+    // Top entry of each bucket and the linked entry pool
+    std::vector<Point::index_type> bucketTop;
+    std::vector<Point::index_type> entryCell;
+    std::vector<Point::index_type> entryNext;
+    size_type maxBucket = 0;
+    size_type expandCnt = 0;
+
+    bool showSearchDetails = false;
+    std::vector<unsigned char> detail;
+
+    // Interval time when showing searched point
+    static const long detailInterval = 10;
+
+    /*
+    Advance a generation counter. All stamps are cleared when
+    the counter wraps around.
+    */
+    static void nextGen(stamp_type &gen, std::vector<stamp_type> &stamps);
+};
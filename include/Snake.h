@@ -2,6 +2,7 @@
 
 #include "Map.h"
 #include "Hamilton.h"
+#include "RingBuffer.h"
 #include <memory>
 
 /*
@@ -10,6 +11,7 @@ Game snake.
 class Snake {
 public:
     typedef Map::size_type size_type;
+    typedef Map::index_type index_type;
 
     Snake();
     ~Snake();
@@ -22,7 +24,7 @@ public:
     /*
     Move the snake according to a given path.
     */
-    void move(const std::list<Direc> &path);
+    void move(const Path &path);
 
     /*
     Check whether the snake is dead.
@@ -36,6 +38,7 @@ public:
     @return true if adding succeed, false otherwise
     */
     bool addBody(const Pos &p);
+    bool addBody(const index_type &i);
 
     /*
     Get the length of the snake.
@@ -52,19 +55,64 @@ public:
     void setHeadType(const Point::Type &type);
     void setBodyType(const Point::Type &type);
     void setTailType(const Point::Type &type);
-    void setMap(std::shared_ptr<Map> m);
+    void setSearchAlgo(const Map::SearchAlgo &algo);
+
+    /*
+    Set the directory where setMap() keeps the hamilton cycle of each
+    wall layout. An empty directory, the default, disables the cache.
+    A cycle loaded from the cache makes no draws from the generator
+    given to setMap(), and may have been generated from another seed,
+    so a cold and a warm cache give different games for the same seed.
+    */
+    void setCycleCacheDir(const std::string &dir);
+
+    /*
+    Set the number of threads setMap() builds the hamilton cycle of a
+    large map on. Default is 0, which uses one thread a core.
+    */
+    void setCycleThreadCount(const unsigned &n);
+
+    /*
+    Set whether decideNext() splices the hamilton cycle to bring the
+    food nearer along it. Default is false.
+    */
+    void setRerouteCycle(const bool &b);
+
     Direc getDirection() const;
 
-    void createBody();
+    /*
+    Get the body cells, the head at the front and the tail at the back.
+    */
+    const RingBuffer<index_type>& getBody() const;
+
+    /*
+    Put the snake on a map and build its hamilton cycle.
+
+    @param m the map
+    @param rng the generator of the random choices of the cycle
+    */
+    void setMap(std::shared_ptr<Map> m, Random &rng);
+
+    /*
+    Create a body of three cells at a random place on the cycle.
+
+    @param rng the generator to draw the place from
+    */
+    void createBody(Random &rng);
 
 private:
     bool dead = false;
     Direc direc = NONE;
     size_type safeLength;
+    Map::SearchAlgo searchAlgo = Map::ASTAR;  // Used for the shortest paths
 
-    std::list<Pos> body;
+    RingBuffer<index_type> body;  // Head at the front, sized to the playable area
     std::shared_ptr<Map> map;
+    SearchContext search;
+    Path pathToFood;  // Reserved to the map size, reused every tick
     Hamilton hamilton;
+    std::string cycleCacheDir;
+    bool rerouteCycle = false;
 
     Point::Type headType;
     Point::Type bodyType;
@@ -75,19 +123,37 @@ private:
 
     @param path the result will be stored in this field.
     */
-    void findMinPathToFood(std::list<Direc> &path);
-    void findMinPathToTail(std::list<Direc> &path);
-    void findMaxPathToTail(std::list<Direc> &path);
+    void findMinPathToFood(Path &path);
+    void findMinPathToTail(Path &path);
+    void findMaxPathToTail(Path &path);
 
     /*
     Find a path from the snake's head to the goal point.
 
     @param type 0->find shortest path
                 1->find longest path
-    @param to the goal point
-    @param path the result will be stored in this field.
+    @param to the goal cell
+    @param path the result will be stored in this field, and left
+                empty if there is no goal or no path.
+    */
+    void findPathTo(const int type, const index_type &to, Path &path);
+
+    /*
+    Store in the search context when each body cell can be entered.
+    The body cell k steps from the head is left after (length - k)
+    moves, and the head can't enter a cell the tail leaves in the
+    same move, so it can be entered from move (length - k + 1).
+    */
+    void updateFreeTime();
+
+    /*
+    Check whether moving the head to a cell keeps all the
+    empty cells connected to it. The food isn't free, so a move is
+    also rejected if only the food links the empty cells. Counting
+    the food as free took more moves and lost more games, since
+    those shortcuts often cut off the region anyway once it's eaten.
     */
-    void findPathTo(const int type, const Pos &to, std::list<Direc> &path);
+    bool keepsFreeRegion(const index_type &next);
 
     /*
     Remove the snake tail.
@@ -95,12 +161,12 @@ private:
     void removeTail();
 
     /*
-    Get the head position.
+    Get the head cell.
     */
-    const Pos& getHead() const;
+    index_type getHead() const;
 
     /*
-    Get the tail position.
+    Get the tail cell.
     */
-    const Pos& getTail() const;
+    index_type getTail() const;
 };
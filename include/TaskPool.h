@@ -0,0 +1,49 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/*
+Thread pool running a batch of independent tasks. Every worker starts
+with an even share of the tasks and, once done with them, steals from
+the other workers, so uneven tasks still keep all the cores busy.
+*/
+class TaskPool {
+public:
+    typedef size_t task_type;
+
+    /*
+    @param threadCnt the number of worker threads, 0 for one a core
+    */
+    explicit TaskPool(const unsigned threadCnt = 0);
+
+    unsigned getThreadCount() const;
+
+    /*
+    Run tasks 0 to taskCnt - 1 and wait for all of them. The calling
+    thread is one of the workers.
+
+    @param task called with the task number, possibly from several
+                threads at once
+    @throw the first exception thrown by a task, after all workers stop
+    */
+    void run(const task_type taskCnt, const std::function<void(task_type)> &task);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<task_type> tasks;
+    };
+
+    unsigned threadCnt;
+
+    /*
+    Take the next task of a worker, from the back of its own queue or
+    else from the front of another one.
+
+    @return false if all queues are empty
+    */
+    static bool take(std::vector<Queue> &queues, const unsigned self, task_type &task);
+};
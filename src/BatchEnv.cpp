@@ -0,0 +1,227 @@
+#include "BatchEnv.h"
+#include "GameSession.h"
+#include <stdexcept>
+
+BatchEnv::BatchEnv(const size_type envCnt_, const size_type rowCnt, const size_type colCnt,
+                   const Random::seed_type seed, const bool hardMode)
+    : envCnt(envCnt_) {
+    if (envCnt == 0) {
+        throw std::range_error("BatchEnv.BatchEnv(): At least one game is required.");
+    }
+    if (rowCnt < 4 || colCnt < 4) {
+        std::string msg = "BatchEnv.BatchEnv(): Map size is at least 4*4. Current size is "
+            + intToStr(rowCnt) + "*" + intToStr(colCnt);
+        throw std::range_error(msg.c_str());
+    }
+
+    maps.reserve(envCnt);
+    rngs.reserve(envCnt);
+    for (size_type k = 0; k < envCnt; ++k) {
+        auto map = std::make_shared<Map>(rowCnt, colCnt);
+        if (hardMode) {
+            GameSession::addHardWalls(*map);
+        }
+        maps.push_back(map);
+        rngs.push_back(Random(seed + k));
+    }
+    capacity = rowCnt * colCnt - maps[0]->getTypeCount(Point::Type::WALL);
+
+    bodies.resize(envCnt * capacity);
+    fronts.assign(envCnt, 0);
+    heads.assign(envCnt, Point::NO_INDEX);
+    lengths.assign(envCnt, 0);
+    direcs.assign(envCnt, NONE);
+    foods.assign(envCnt, Point::NO_INDEX);
+    hungers.assign(envCnt, 0);
+    rewards.assign(envCnt, 0);
+    dones.assign(envCnt, 0);
+    resetAll();
+}
+
+BatchEnv::~BatchEnv() {}
+
+BatchEnv::index_type& BatchEnv::bodyAt(const size_type k, const size_type i) {
+    return bodies[k * capacity + (fronts[k] + i) % capacity];
+}
+
+void BatchEnv::resetAll() {
+    for (size_type k = 0; k < envCnt; ++k) {
+        reset(k);
+    }
+}
+
+void BatchEnv::clear(const size_type k) {
+    Map &map = *maps[k];
+    for (size_type i = 0; i < lengths[k]; ++i) {
+        map.setType(bodyAt(k, i), Point::Type::EMPTY);
+    }
+    map.removeFood();
+    foods[k] = Point::NO_INDEX;
+    fronts[k] = 0;
+    lengths[k] = 0;
+}
+
+void BatchEnv::reset(const size_type k) {
+    Map &map = *maps[k];
+    Random &rng = rngs[k];
+    clear(k);
+
+    // Grow the snake from a random cell by a random walk, and start
+    // over if it runs into a dead end
+    static const Direc allDirecs[4] = {LEFT, UP, RIGHT, DOWN};
+    for (int attempt = 0; attempt < 100 && lengths[k] < 3; ++attempt) {
+        for (size_type i = 0; i < lengths[k]; ++i) {
+            map.setType(bodyAt(k, i), Point::Type::EMPTY);
+        }
+        lengths[k] = 0;
+        index_type cur = map.randomEmpty(rng);
+        while (cur != Point::NO_INDEX) {
+            map.setType(cur, Point::Type::SNAKE_BODY);
+            bodyAt(k, lengths[k]++) = cur;
+            if (lengths[k] == 3) {
+                break;
+            }
+            index_type next = Point::NO_INDEX;
+            auto first = rng.below(4);
+            for (int d = 0; d < 4 && next == Point::NO_INDEX; ++d) {
+                auto adj = map.getAdj(cur, allDirecs[(first + d) % 4]);
+                if (map.isEmpty(adj)) {
+                    next = adj;
+                }
+            }
+            cur = next;
+        }
+    }
+    if (lengths[k] < 3) {
+        throw std::runtime_error("BatchEnv.reset(): No room for the snake.");
+    }
+
+    heads[k] = bodyAt(k, 0);
+    map.setType(heads[k], Point::Type::SNAKE_HEAD);
+    map.setType(bodyAt(k, 2), Point::Type::SNAKE_TAIL);
+    direcs[k] = map.getDirection(bodyAt(k, 1), heads[k]);
+    hungers[k] = 0;
+    map.createRandFood(rng);
+    foods[k] = map.getFood();
+}
+
+void BatchEnv::setGame(const size_type k, const std::vector<index_type> &body, const Direc direc,
+                       const index_type food) {
+    Map &map = *maps[k];
+    clear(k);
+    bool valid = body.size() >= 2 && body.size() <= capacity;
+    for (size_type i = 0; valid && i < body.size(); ++i) {
+        valid = map.isInside(body[i]) && map.getType(body[i]) == Point::Type::EMPTY
+                && (i == 0 || map.getDirection(body[i], body[i - 1]) != NONE);
+        if (valid) {
+            map.setType(body[i], Point::Type::SNAKE_BODY);
+            bodyAt(k, lengths[k]++) = body[i];
+        }
+    }
+    valid = valid && map.isInside(food) && map.getType(food) == Point::Type::EMPTY;
+    if (!valid) {
+        reset(k);
+        throw std::range_error("BatchEnv.setGame(): Invalid snake or food.");
+    }
+
+    heads[k] = body.front();
+    map.setType(heads[k], Point::Type::SNAKE_HEAD);
+    map.setType(body.back(), Point::Type::SNAKE_TAIL);
+    direcs[k] = direc;
+    hungers[k] = 0;
+    map.createFood(food);
+    foods[k] = food;
+}
+
+void BatchEnv::step(const Direc *actions) {
+    for (size_type k = 0; k < envCnt; ++k) {
+        Map &map = *maps[k];
+        if (actions[k] != NONE) {
+            direcs[k] = actions[k];
+        }
+        rewards[k] = 0;
+        dones[k] = 0;
+
+        // Same rules as Snake::move(): the tail is checked before it
+        // moves away, so following it closely is a collision
+        index_type newHead = map.getAdj(heads[k], direcs[k]);
+        if (!map.isSafe(newHead)) {
+            rewards[k] = -1;
+            dones[k] = 1;
+            reset(k);
+            continue;
+        }
+
+        bool eat = map.getType(newHead) == Point::Type::FOOD;
+        map.setType(heads[k], Point::Type::SNAKE_BODY);
+        if (eat) {
+            map.removeFood();
+            foods[k] = Point::NO_INDEX;
+            ++lengths[k];
+            hungers[k] = 0;
+            rewards[k] = 1;
+        } else {
+            map.setType(bodyAt(k, lengths[k] - 1), Point::Type::EMPTY);
+            map.setType(bodyAt(k, lengths[k] - 2), Point::Type::SNAKE_TAIL);
+            ++hungers[k];
+        }
+        fronts[k] = (fronts[k] + capacity - 1) % capacity;
+        bodyAt(k, 0) = newHead;
+        heads[k] = newHead;
+        map.setType(newHead, Point::Type::SNAKE_HEAD);
+
+        if (eat) {
+            if (map.isAllBody()) {
+                dones[k] = 1;
+            } else {
+                map.createRandFood(rngs[k]);
+                foods[k] = map.getFood();
+            }
+        } else if (hungers[k] >= capacity) {
+            dones[k] = 1;
+        }
+        if (dones[k]) {
+            reset(k);
+        }
+    }
+}
+
+BatchEnv::size_type BatchEnv::size() const {
+    return envCnt;
+}
+
+BatchEnv::size_type BatchEnv::getRowCount() const {
+    return maps[0]->getRowCount();
+}
+
+BatchEnv::size_type BatchEnv::getColCount() const {
+    return maps[0]->getColCount();
+}
+
+const Map::cell_type* BatchEnv::getCells(const size_type k) const {
+    return maps[k]->getCells();
+}
+
+const BatchEnv::reward_type* BatchEnv::getRewards() const {
+    return rewards.data();
+}
+
+const unsigned char* BatchEnv::getDones() const {
+    return dones.data();
+}
+
+const BatchEnv::index_type* BatchEnv::getHeads() const {
+    return heads.data();
+}
+
+const BatchEnv::size_type* BatchEnv::getLengths() const {
+    return lengths.data();
+}
+
+const Direc* BatchEnv::getDirections() const {
+    return direcs.data();
+}
+
+const BatchEnv::index_type* BatchEnv::getFoods() const {
+    return foods.data();
+}
@@ -0,0 +1,163 @@
+#include "Bitboard.h"
+#include <algorithm>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+const Bitboard::size_type Bitboard::WORD_BITS;
+
+namespace {
+
+/*
+Kogge-Stone fill toward the higher bits of a word.
+*/
+inline Bitboard::word_type fillUp(Bitboard::word_type g, Bitboard::word_type p) {
+    g |= p & (g << 1);  p &= p << 1;
+    g |= p & (g << 2);  p &= p << 2;
+    g |= p & (g << 4);  p &= p << 4;
+    g |= p & (g << 8);  p &= p << 8;
+    g |= p & (g << 16); p &= p << 16;
+    g |= p & (g << 32);
+    return g;
+}
+
+/*
+Kogge-Stone fill toward the lower bits of a word.
+*/
+inline Bitboard::word_type fillDown(Bitboard::word_type g, Bitboard::word_type p) {
+    g |= p & (g >> 1);  p &= p >> 1;
+    g |= p & (g >> 2);  p &= p >> 2;
+    g |= p & (g >> 4);  p &= p >> 4;
+    g |= p & (g >> 8);  p &= p >> 8;
+    g |= p & (g >> 16); p &= p >> 16;
+    g |= p & (g >> 32);
+    return g;
+}
+
+const Bitboard::word_type HIGH_BIT = static_cast<Bitboard::word_type>(1) << 63;
+
+inline Bitboard::size_type popCount(Bitboard::word_type w) {
+#ifdef _MSC_VER
+    return static_cast<Bitboard::size_type>(__popcnt64(w));
+#else
+    return static_cast<Bitboard::size_type>(__builtin_popcountll(w));
+#endif
+}
+
+}
+
+Bitboard::Bitboard() {
+}
+
+Bitboard::Bitboard(const size_type &rowCnt_, const size_type &colCnt_) {
+    resize(rowCnt_, colCnt_);
+}
+
+Bitboard::~Bitboard() {
+}
+
+void Bitboard::resize(const size_type &rowCnt_, const size_type &colCnt_) {
+    rowCnt = rowCnt_;
+    colCnt = colCnt_;
+    rowWords = (colCnt + WORD_BITS - 1) / WORD_BITS;
+    bits.assign(rowCnt * rowWords, 0);
+}
+
+const Bitboard::word_type* Bitboard::row(const size_type &i) const {
+    return &bits[i * rowWords];
+}
+
+Bitboard::word_type* Bitboard::row(const size_type &i) {
+    return &bits[i * rowWords];
+}
+
+bool Bitboard::test(const Pos &p) const {
+    size_type j = p.getY();
+    return (row(p.getX())[j / WORD_BITS] >> (j % WORD_BITS)) & 1;
+}
+
+void Bitboard::set(const Pos &p, const bool b) {
+    size_type j = p.getY();
+    word_type bit = static_cast<word_type>(1) << (j % WORD_BITS);
+    word_type &w = row(p.getX())[j / WORD_BITS];
+    if (b) {
+        w |= bit;
+    } else {
+        w &= ~bit;
+    }
+}
+
+void Bitboard::clear() {
+    std::fill(bits.begin(), bits.end(), 0);
+}
+
+Bitboard::size_type Bitboard::count() const {
+    size_type cnt = 0;
+    for (const auto &w : bits) {
+        cnt += popCount(w);
+    }
+    return cnt;
+}
+
+bool Bitboard::fillRow(word_type *seed, const word_type *mask) const {
+    bool changed = false;
+
+    // Toward higher columns, carrying into the next word
+    word_type carry = 0;
+    for (size_type k = 0; k < rowWords; ++k) {
+        word_type g = fillUp(seed[k] | (carry & mask[k]), mask[k]);
+        carry = (g & HIGH_BIT) ? 1 : 0;
+        changed |= (g != seed[k]);
+        seed[k] = g;
+    }
+
+    // Toward lower columns, carrying into the previous word
+    carry = 0;
+    for (size_type k = rowWords; k-- > 0;) {
+        word_type g = fillDown(seed[k] | (carry & mask[k]), mask[k]);
+        carry = (g & 1) ? HIGH_BIT : 0;
+        changed |= (g != seed[k]);
+        seed[k] = g;
+    }
+    return changed;
+}
+
+bool Bitboard::floodFill(const Pos &from, Bitboard &reach, const size_type maxSweeps) const {
+    if (reach.rowCnt != rowCnt || reach.colCnt != colCnt) {
+        reach.resize(rowCnt, colCnt);
+    } else {
+        reach.clear();
+    }
+    // The source bit needn't be set since the fills only mask the
+    // bits expanded into
+    reach.set(from, true);
+
+    bool changed = true;
+    bool down = true;
+    for (size_type sweep = 0; changed; ++sweep) {
+        if (maxSweeps > 0 && sweep == maxSweeps) {
+            return false;
+        }
+        changed = false;
+
+        // Sweep the rows downward and upward alternately so that a
+        // vertical corridor is filled in a single sweep
+        for (size_type n = 0; n < rowCnt; ++n) {
+            size_type i = down ? n : rowCnt - 1 - n;
+            const word_type *mask = row(i);
+            word_type *cur = reach.row(i);
+            const word_type *up = i > 0 ? reach.row(i - 1) : nullptr;
+            const word_type *dn = i + 1 < rowCnt ? reach.row(i + 1) : nullptr;
+
+            for (size_type k = 0; k < rowWords; ++k) {
+                word_type vert = (up ? up[k] : 0) | (dn ? dn[k] : 0);
+                word_type g = cur[k] | (vert & mask[k]);
+                changed |= (g != cur[k]);
+                cur[k] = g;
+            }
+            changed |= fillRow(cur, mask);
+        }
+        down = !down;
+    }
+    return true;
+}
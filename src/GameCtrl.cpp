@@ -8,7 +8,6 @@
 #endif
 
 using std::string;
-using std::list;
 
 const string GameCtrl::MSG_BAD_ALLOC = "Oops! Not enough memory to run the game! ";
 const string GameCtrl::MSG_LOSE = "Oops! You lose! ";
@@ -77,7 +76,18 @@ void GameCtrl::setRecordMovements(const bool &b) {
     recordMovements = b;
 }
 
+void GameCtrl::setCycleCacheDir(const std::string &dir) {
+    cycleCacheDir = dir;
+}
+
+void GameCtrl::setHeadless(const bool &b) {
+    headless = b;
+}
+
 int GameCtrl::run() {
+    if (headless) {
+        return runHeadless();
+    }
     try {
         init();
         if (runTest) {
@@ -94,14 +104,55 @@ int GameCtrl::run() {
     return 0;
 }
 
+int GameCtrl::runHeadless() {
+    try {
+        initSession();
+        session.init();
+        map = session.getMap();
+        if (recordMovements) {
+            initFiles();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        if (recordMovements) {
+            while (!session.isOver()) {
+                session.tick();
+                writeMapToFile();
+            }
+        } else {
+            session.play();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (movementFile) {
+            fclose(movementFile);
+            movementFile = nullptr;
+        }
+        long long moves = session.getMoveCount();
+        printf("%s\nScore: %ld\nLength: %lu\nMoves: %lld\nTime: %.3fs (%.0f moves/s)\n",
+               (session.isWin() ? MSG_WIN : MSG_LOSE).c_str(), session.getScore(),
+               static_cast<unsigned long>(session.getSnake().length()), moves,
+               seconds, seconds > 0 ? moves / seconds : 0.0);
+        return session.isWin() ? 0 : 1;
+    } catch (const std::exception &e) {
+        fprintf(stderr, "Exception: %s\n", e.what());
+        return 1;
+    }
+}
+
 void GameCtrl::init() {
     Console::clear();
-    initMap();
+    initSession();
     if (!runTest) {
-        initSnakes();
+        session.init();
+        map = session.getMap();
         if (recordMovements) {
             initFiles();
         }
+    } else {
+        session.initMap();
+        map = session.getMap();
+        testSearch.resize(mapRowCnt, mapColCnt);
     }
     startThreads();
 }
@@ -116,37 +167,11 @@ void GameCtrl::teardown() {
     }
 }
 
-void GameCtrl::initMap() {
-    if (mapRowCnt < 4 || mapColCnt < 4) {
-        string msg = "GameCtrl.initMap(): Map size is at least 4*4. Current size is "
-            + intToStr(mapRowCnt) + "*" + intToStr(mapColCnt);
-        throw std::range_error(msg.c_str());
-    }
-
-    map = std::make_shared<Map>(mapRowCnt, mapColCnt);
-    if (!map) {
-        exitGame(MSG_BAD_ALLOC);
-    } else {
-        // Add some extra walls manully
-        if (hardMode) {
-            if (mapRowCnt != 20 || mapColCnt != 20) {
-                throw std::range_error("GameCtrl.testGraphSearch(): Require map size 20*20.");
-            }
-            for (int i = 4; i < 16; ++i) {
-                map->getPoint(Pos(i, 9)).setType(Point::Type::WALL);   // vertical
-                map->getPoint(Pos(4, i)).setType(Point::Type::WALL);   // horizontal #1
-                map->getPoint(Pos(15, i)).setType(Point::Type::WALL);  // horizontal #2
-            }
-        }
-    }
-}
-
-void GameCtrl::initSnakes() {
-    snake.setHeadType(Point::Type::SNAKE_HEAD);
-    snake.setBodyType(Point::Type::SNAKE_BODY);
-    snake.setTailType(Point::Type::SNAKE_TAIL);
-    snake.setMap(map);
-    snake.createBody();
+void GameCtrl::initSession() {
+    session.setMapRow(mapRowCnt);
+    session.setMapCol(mapColCnt);
+    session.setHardMode(hardMode);
+    session.setCycleCacheDir(cycleCacheDir);
 }
 
 void GameCtrl::initFiles() {
@@ -162,18 +187,18 @@ void GameCtrl::initFiles() {
     }
 }
 
-void GameCtrl::moveSnake(Snake &s) {
+void GameCtrl::moveSnake(const bool decide) {
     mutexMove.lock();
-    if (map->isAllBody()) {
+    if (session.isWin()) {
         mutexMove.unlock();
         exitGame(MSG_WIN);
-    } else if (s.isDead()) {
+    } else if (session.isDead()) {
         mutexMove.unlock();
         exitGame(MSG_LOSE);
     } else {
         try {
-            s.move();
-            if (recordMovements && s.getDirection() != NONE) {
+            session.tick(decide);
+            if (recordMovements && session.getSnake().getDirection() != NONE) {
                 writeMapToFile();
             }
             mutexMove.unlock();
@@ -192,7 +217,7 @@ void GameCtrl::writeMapToFile() const {
     auto cols = map->getColCount();
     for (Map::size_type i = 0; i < rows; ++i) {
         for (Map::size_type j = 0; j < cols; ++j) {
-            switch (map->getPoint(Pos(i, j)).getType()) {
+            switch (map->getType(Pos(i, j))) {
                 case Point::Type::EMPTY:
                     fwrite("  ", sizeof(char), 2, movementFile); break;
                 case Point::Type::WALL:
@@ -238,13 +263,6 @@ void GameCtrl::stopThreads() {
 void GameCtrl::game() {
     try {
         while (threadWork) {
-            if (!runTest) {
-                score += scoreTime;
-                if (!map->hasFood()) {
-                    map->createRandFood();
-                    score += scoreFood;
-                }
-            }
             drawMapContent();
             sleepByFPS();
         }
@@ -259,8 +277,12 @@ void GameCtrl::drawMapContent() const {
     auto cols = map->getColCount();
     for (Map::size_type i = 0; i < rows; ++i) {
         for (Map::size_type j = 0; j < cols; ++j) {
-            const Point &point = map->getPoint(Pos(i, j));
-            switch (point.getType()) {
+            auto cell = map->toIndex(Pos(i, j));
+            auto type = map->getType(cell);
+            if (runTest && type == Point::Type::EMPTY) {
+                type = testSearch.getDetail(cell);
+            }
+            switch (type) {
                 case Point::Type::EMPTY:
                     Console::writeWithColor("  ", ConsoleColor(BLACK, BLACK));
                     break;
@@ -280,10 +302,10 @@ void GameCtrl::drawMapContent() const {
                     Console::writeWithColor("  ", ConsoleColor(BLUE, BLUE, true, true));
                     break;
                 case Point::Type::TEST_VISIT:
-                    drawTestPoint(point, ConsoleColor(BLUE, GREEN, true, true));
+                    drawTestPoint(cell, ConsoleColor(BLUE, GREEN, true, true));
                     break;
                 case Point::Type::TEST_PATH:
-                    drawTestPoint(point, ConsoleColor(BLUE, RED, true, true));
+                    drawTestPoint(cell, ConsoleColor(BLUE, RED, true, true));
                     break;
                 default:
                     break;
@@ -293,7 +315,7 @@ void GameCtrl::drawMapContent() const {
     }
 
     if (!runTest) {
-        Console::write("Score: " + intToStr(score) + "    \n");
+        Console::write("Score: " + intToStr(session.getScore()) + "    \n");
         Console::write("Time: "
                         + intToStr(std::chrono::duration_cast<std::chrono::microseconds>(thinkingTime).count())
                         + "us  / "
@@ -317,12 +339,13 @@ std::string dirToStr(Direc d) {
     }
 }
 
-void GameCtrl::drawTestPoint(const Point &p, const ConsoleColor &consoleColor) const {
+void GameCtrl::drawTestPoint(const Map::index_type &i, const ConsoleColor &consoleColor) const {
     string pointStr = "";
-    if (p.getParent() == Pos::INVALID || p.getPos() == Pos::INVALID) {
+    auto parent = testSearch.getParent(i);
+    if (parent == Point::NO_INDEX) {
         pointStr = "  ";
     } else {
-        pointStr += dirToStr(p.getParent().getDirectionTo(p.getPos()));
+        pointStr += dirToStr(map->getDirection(parent, i));
         pointStr += " ";
     }
     Console::writeWithColor(pointStr, consoleColor);
@@ -334,16 +357,16 @@ void GameCtrl::keyboard() {
             if (Console::kbhit()) {
                 switch (Console::getch()) {
                     case 'w':
-                        keyboardMove(snake, Direc::UP);
+                        keyboardMove(Direc::UP);
                         break;
                     case 'a':
-                        keyboardMove(snake, Direc::LEFT);
+                        keyboardMove(Direc::LEFT);
                         break;
                     case 's':
-                        keyboardMove(snake, Direc::DOWN);
+                        keyboardMove(Direc::DOWN);
                         break;
                     case 'd':
-                        keyboardMove(snake, Direc::RIGHT);
+                        keyboardMove(Direc::RIGHT);
                         break;
                     case ' ':
                         pause = !pause;  // Pause or resume game
@@ -362,13 +385,14 @@ void GameCtrl::keyboard() {
     }
 }
 
-void GameCtrl::keyboardMove(Snake &s, const Direc &d) {
+void GameCtrl::keyboardMove(const Direc &d) {
+    Snake &s = session.getSnake();
     if (pause) {
         s.setDirection(d);
-        moveSnake(s);
+        moveSnake(false);
     } else if (!enableAI) {
         if (s.getDirection() == d) {
-            moveSnake(s);  // Accelerate
+            moveSnake(false);  // Accelerate
         } else {
             s.setDirection(d);
         }
@@ -380,10 +404,7 @@ void GameCtrl::autoMove() {
         while (threadWork) {
             auto iterstart = std::chrono::steady_clock::now();
             if (!pause) {
-                if (enableAI) {
-                    snake.decideNext();
-                }
-                moveSnake(snake);
+                moveSnake(enableAI);
             }
             auto iterend = std::chrono::steady_clock::now();
             thinkingTime = iterend - iterstart;
@@ -400,7 +421,7 @@ void GameCtrl::autoMove() {
 
 void GameCtrl::testCreateFood() {
     while (1) {
-        map->createRandFood();
+        map->createRandFood(session.getRandom());
         sleepByFPS();
     }
 }
@@ -410,16 +431,19 @@ void GameCtrl::testGraphSearch() {
         throw std::range_error("GameCtrl.testGraphSearch(): Require map size 20*20.");
     }
 
-    list<Direc> path;
-    map->setShowSearchDetails(true);
+    Path path;
+    testSearch.setShowSearchDetails(true);
 
     Pos from(6, 7), to(14, 13);
-    map->findMinPath(from, to, Direc::NONE, path);
-    //map->findMaxPath(from, to, Direc::NONE, path);
+    map->findMinPath(map->toIndex(from), map->toIndex(to), Direc::NONE, testSearch, path);
+    //map->findMinPath(map->toIndex(from), map->toIndex(to), Direc::NONE, testSearch, path, Map::ASTAR);
+    //map->findMinPath(map->toIndex(from), map->toIndex(to), Direc::NONE, testSearch, path, Map::BIBFS);
+    //map->findMaxPath(map->toIndex(from), map->toIndex(to), Direc::NONE, testSearch, path);
 
     // Print result path info
     string res = "Path from " + from.toString() + " to " + to.toString()
-        + " of length " + intToStr(path.size()) + ":\n";
+        + " of length " + intToStr(path.size())
+        + " (" + intToStr(testSearch.getExpandCount()) + " nodes expanded):\n";
     for (const auto &d : path) {
         res += dirToStr(d);
     }
@@ -427,10 +451,10 @@ void GameCtrl::testGraphSearch() {
 }
 
 void GameCtrl::testHamilton() {
-    map->setShowSearchDetails(true);
+    testSearch.setShowSearchDetails(true);
 
     Hamilton ham;
-    ham.generate(*map);
+    ham.generate(*map, testSearch, session.getRandom());
 
     std::cout << ham << std::endl;
 
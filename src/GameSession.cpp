@@ -0,0 +1,155 @@
+#include "GameSession.h"
+#include <stdexcept>
+
+GameSession::GameSession() : seed(Random::timeSeed()) {}
+
+GameSession::~GameSession() {}
+
+void GameSession::setMapRow(const Map::size_type &n) {
+    mapRowCnt = n;
+}
+
+void GameSession::setMapCol(const Map::size_type &n) {
+    mapColCnt = n;
+}
+
+void GameSession::setHardMode(const bool &b) {
+    hardMode = b;
+}
+
+void GameSession::setCycleCacheDir(const std::string &dir) {
+    cycleCacheDir = dir;
+}
+
+void GameSession::setCycleThreadCount(const unsigned &n) {
+    cycleThreadCnt = n;
+}
+
+void GameSession::setSeed(const Random::seed_type &s) {
+    seed = s;
+}
+
+Random::seed_type GameSession::getSeed() const {
+    return seed;
+}
+
+void GameSession::init() {
+    rng.seed(seed);
+    initMap();
+    initSnake();
+    score = 0;
+    moveCnt = 0;
+    thinkingTime = duration_type::zero();
+    createFoodIfNeed();
+}
+
+void GameSession::initMap() {
+    if (mapRowCnt < 4 || mapColCnt < 4) {
+        std::string msg = "GameSession.initMap(): Map size is at least 4*4. Current size is "
+            + intToStr(mapRowCnt) + "*" + intToStr(mapColCnt);
+        throw std::range_error(msg.c_str());
+    }
+
+    map = std::make_shared<Map>(mapRowCnt, mapColCnt);
+    map->setUseBitboard(true);
+    map->setUseFoodDist(true);
+
+    if (hardMode) {
+        addHardWalls(*map);
+    }
+}
+
+void GameSession::addHardWalls(Map &map) {
+    if (map.getRowCount() != 20 || map.getColCount() != 20) {
+        throw std::range_error("GameSession.addHardWalls(): Hard mode requires map size 20*20.");
+    }
+    // Add some extra walls manully
+    for (int i = 4; i < 16; ++i) {
+        map.setType(Pos(i, 9), Point::Type::WALL);   // vertical
+        map.setType(Pos(4, i), Point::Type::WALL);   // horizontal #1
+        map.setType(Pos(15, i), Point::Type::WALL);  // horizontal #2
+    }
+}
+
+void GameSession::initSnake() {
+    snake = Snake();
+    snake.setHeadType(Point::Type::SNAKE_HEAD);
+    snake.setBodyType(Point::Type::SNAKE_BODY);
+    snake.setTailType(Point::Type::SNAKE_TAIL);
+    snake.setCycleCacheDir(cycleCacheDir);
+    snake.setCycleThreadCount(cycleThreadCnt);
+    snake.setRerouteCycle(true);
+    snake.setMap(map, rng);
+    snake.createBody(rng);
+}
+
+void GameSession::createFoodIfNeed() {
+    if (!map->hasFood() && !map->isAllBody()) {
+        map->createRandFood(rng);
+        score += scoreFood;
+    }
+}
+
+void GameSession::tick(const bool decide) {
+    if (isOver()) {
+        return;
+    }
+    if (decide) {
+        auto start = std::chrono::steady_clock::now();
+        snake.decideNext();
+        thinkingTime = std::chrono::steady_clock::now() - start;
+    }
+    if (snake.getDirection() == NONE) {
+        return;
+    }
+    snake.move();
+    score += scoreTime;
+    ++moveCnt;
+    createFoodIfNeed();
+}
+
+void GameSession::play(const long long maxMoves) {
+    while (!isOver() && (maxMoves == 0 || moveCnt < maxMoves)) {
+        tick();
+    }
+}
+
+bool GameSession::isOver() const {
+    return isWin() || isDead();
+}
+
+bool GameSession::isWin() const {
+    return map->isAllBody();
+}
+
+bool GameSession::isDead() const {
+    return snake.isDead();
+}
+
+long GameSession::getScore() const {
+    return score;
+}
+
+long long GameSession::getMoveCount() const {
+    return moveCnt;
+}
+
+GameSession::duration_type GameSession::getThinkingTime() const {
+    return thinkingTime;
+}
+
+std::shared_ptr<Map> GameSession::getMap() const {
+    return map;
+}
+
+Random& GameSession::getRandom() {
+    return rng;
+}
+
+Snake& GameSession::getSnake() {
+    return snake;
+}
+
+const Snake& GameSession::getSnake() const {
+    return snake;
+}
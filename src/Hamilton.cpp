@@ -1,78 +1,931 @@
 #include "Map.h"
 #include "Pos.h"
 #include "Hamilton.h"
+#include "TaskPool.h"
 
 #include <vector>
 #include <iostream>
+#include <fstream>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
 #include <algorithm>
+#include <atomic>
+#include <thread>
 
-void Hamilton::generate(Map& map) {
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char CACHE_MAGIC[4] = {'H', 'A', 'M', 'C'};
+static const uint32_t CACHE_VERSION = 1;
+
+/*
+Get a file name suffix no other writer uses at the same time, from the
+process id and a counter of the process.
+*/
+static std::string tempSuffix() {
+    static std::atomic<unsigned> counter(0);
+#ifdef _WIN32
+    int pid = _getpid();
+#else
+    int pid = static_cast<int>(getpid());
+#endif
+    return "." + intToStr(pid) + "_" + intToStr(static_cast<int>(counter++)) + ".tmp";
+}
+
+const size_t Hamilton::PARALLEL_MIN_CELLS = 1 << 20;
+const int Hamilton::MAX_REROUTE_ROUNDS = 4;
+const size_t Hamilton::TILE_BLOCK_ROWS = 64;
+
+void Hamilton::generate(const Map& map, SearchContext& ctx, Random& rng) {
+    reset(map);
+    if (!generateFromBlocks(map, rng)) {
+        generateBySearch(map, ctx, rng);
+    }
+}
+
+void Hamilton::reset(const Map& map) {
     size_t rows = map.getRowCount();
     size_t columns = map.getColCount();
 
     // Expand backing stores
-    steps.resize(rows);
-    sequence.resize(rows);
-    for (size_t i=0; i<rows; i++) {
-        steps[i].resize(columns);
-        sequence[i].resize(columns);
+    steps.assign(rows * columns, NONE);
+    sequence.assign(rows * columns, 0);
+    handleAt.assign(rows * columns, Point::NO_INDEX);
+    nearHandle.assign(rows * columns, 0);
+    colCnt = columns;
+    for (int d = NONE; d <= DOWN; d++) {
+        adjOffset[d] = map.getAdjOffset(static_cast<Direc>(d));
+    }
+}
+
+uint64_t Hamilton::layoutHash(const Map& map) {
+    // FNV-1a over the size and one bit per cell
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](uint64_t v) {
+        hash ^= v;
+        hash *= 1099511628211ULL;
+    };
+    size_t cellCnt = map.getRowCount() * map.getColCount();
+    mix(map.getRowCount());
+    mix(map.getColCount());
+    for (size_t i = 0; i < cellCnt; i += 8) {
+        unsigned char bits = 0;
+        for (size_t j = i; j < i + 8 && j < cellCnt; j++) {
+            bits = (bits << 1) | (map.getType(j) != Point::Type::EMPTY);
+        }
+        mix(bits);
+    }
+    return hash;
+}
+
+std::string Hamilton::cacheName(const Map& map) {
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(layoutHash(map)));
+    return "hamilton_" + intToStr(map.getRowCount()) + "x" + intToStr(map.getColCount())
+           + "_" + hex + ".bin";
+}
+
+bool Hamilton::save(const Map& map, const std::string& filename) const {
+    size_t cellCnt = map.getRowCount() * map.getColCount();
+    if (steps.size() != cellCnt) {
+        return false;
+    }
+
+    CacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.rows = map.getRowCount();
+    header.cols = map.getColCount();
+    header.layout = layoutHash(map);
+
+    // Four cells a byte, LEFT to DOWN stored as 0 to 3
+    std::vector<unsigned char> packed((cellCnt + 3) / 4, 0);
+    for (size_t i = 0; i < cellCnt; i++) {
+        if (steps[i] != NONE) {
+            packed[i / 4] |= (steps[i] - LEFT) << (i % 4 * 2);
+        }
+    }
+
+    // Write a file of our own and move it over the cache in one step,
+    // so a reader never sees a partly written cache
+    std::string tmpName = filename + tempSuffix();
+    std::ofstream out(tmpName, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+    out.close();
+    if (!out) {
+        std::remove(tmpName.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    // rename() doesn't replace an existing file here
+    std::remove(filename.c_str());
+#endif
+    if (std::rename(tmpName.c_str(), filename.c_str()) != 0) {
+        std::remove(tmpName.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Hamilton::load(const Map& map, const std::string& filename) {
+#ifdef _WIN32
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::vector<char> buf((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return loadFrom(map, reinterpret_cast<const unsigned char*>(buf.data()), buf.size());
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = st.st_size;
+    void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    bool ok = loadFrom(map, static_cast<const unsigned char*>(data), size);
+    munmap(data, size);
+    return ok;
+#endif
+}
+
+bool Hamilton::loadFrom(const Map& map, const unsigned char* data, const size_t size) {
+    size_t cellCnt = map.getRowCount() * map.getColCount();
+    CacheHeader header;
+    if (size != sizeof(header) + (cellCnt + 3) / 4) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0
+            || header.version != CACHE_VERSION
+            || header.rows != map.getRowCount()
+            || header.cols != map.getColCount()
+            || header.layout != layoutHash(map)) {
+        return false;
+    }
+
+    // Keep the current cycle until the new one is checked
+    Hamilton loaded;
+    loaded.threadCnt = threadCnt;
+    loaded.reset(map);
+    const unsigned char *packed = data + sizeof(header);
+    for (size_t i = 0; i < cellCnt; i++) {
+        if (map.getType(i) == Point::Type::EMPTY) {
+            loaded.steps[i] = LEFT + ((packed[i / 4] >> (i % 4 * 2)) & 3);
+        }
+    }
+
+    // Following the steps from any empty cell must return to it after
+    // visiting every empty cell and nothing else
+    index_type start = Point::NO_INDEX;
+    for (size_t i = 0; i < cellCnt && start == Point::NO_INDEX; i++) {
+        if (map.getType(i) == Point::Type::EMPTY) {
+            start = i;
+        }
+    }
+    if (start == Point::NO_INDEX) {
+        return false;
+    }
+    size_t emptyCnt = map.getEmptyCount(), len = 0;
+    index_type cur = start;
+    do {
+        if (map.getType(cur) != Point::Type::EMPTY || len == emptyCnt) {
+            return false;
+        }
+        cur = loaded.next(cur);
+        len++;
+    } while (cur != start);
+    if (len != emptyCnt) {
+        return false;
+    }
+
+    loaded.maxSequence = emptyCnt - 1;
+    loaded.numberFrom(start);
+    *this = std::move(loaded);
+    return true;
+}
+
+bool Hamilton::generateFromBlocks(const Map& map, Random& rng) {
+    size_t rows = map.getRowCount();
+    size_t columns = map.getColCount();
+    if (rows < 4 || columns < 4) {
+        return false;
+    }
+    size_t cellCnt = rows * columns;
+    size_t blockRows = (rows - 2) / 2;
+    size_t blockCols = (columns - 2) / 2;
+    size_t blockCnt = blockRows * blockCols;
+
+    // Top left cell of a block, and the block of a cell, which is
+    // blockCnt past the last whole block row or column
+    auto corner = [&](size_t b) {
+        return map.toIndex(Pos(1 + b / blockCols * 2, 1 + b % blockCols * 2));
+    };
+    auto blockOf = [&](index_type i) {
+        size_t r = i / columns - 1, c = i % columns - 1;
+        if (r >= blockRows * 2 || c >= blockCols * 2) {
+            return blockCnt;
+        }
+        return r / 2 * blockCols + c / 2;
+    };
+    auto isEmpty = [&](index_type i) {
+        return map.getType(i) == Point::Type::EMPTY;
+    };
+    index_type down = adjOffset[DOWN], right = adjOffset[RIGHT];
+
+    // The blocks of a large map are split into tiles of whole block rows.
+    // The tiles depend on the map only, so a seed builds the same cycle
+    // whatever the number of threads.
+    unsigned tileCnt = 1;
+    if (cellCnt >= PARALLEL_MIN_CELLS) {
+        tileCnt = static_cast<unsigned>((blockRows + TILE_BLOCK_ROWS - 1) / TILE_BLOCK_ROWS);
+    }
+    unsigned workerCnt = std::min(workerCount(cellCnt), tileCnt);
+    auto tileBegin = [&](size_t t) {
+        return blockRows * t / tileCnt * blockCols;
+    };
+
+    TaskPool pool(workerCnt);
+    std::vector<unsigned char> freeBlock(blockCnt, 0);
+    pool.run(tileCnt, [&](TaskPool::task_type t) {
+        for (size_t b = tileBegin(t); b < tileBegin(t + 1); b++) {
+            index_type tl = corner(b);
+            freeBlock[b] = isEmpty(tl) && isEmpty(tl + right) && isEmpty(tl + down)
+                           && isEmpty(tl + down + right);
+        }
+    });
+
+    // The empty cells outside the free blocks, in blocks cut by walls or
+    // past the last whole block row or column
+    std::vector<index_type> loose;
+    for (size_t b = 0; b < blockCnt; b++) {
+        if (!freeBlock[b]) {
+            index_type tl = corner(b);
+            for (index_type i : {tl, tl + right, tl + down, tl + down + right}) {
+                if (isEmpty(i)) {
+                    loose.push_back(i);
+                }
+            }
+        }
+    }
+    for (size_t r = 1; r + 1 < rows; r++) {
+        for (size_t c = (r > blockRows * 2) ? 1 : blockCols * 2 + 1; c + 1 < columns; c++) {
+            index_type i = map.toIndex(Pos(r, c));
+            if (isEmpty(i)) {
+                loose.push_back(i);
+            }
+        }
+    }
+
+    // Cover the loose cells with small cycles as well. Every cell needs
+    // links to two neighbours, one bit a direction, and the free blocks
+    // start linked as small cycles. A cell short of links gets one by a
+    // breadth first search for a path to another one short of links,
+    // whose steps alternate between unlinked and linked neighbours, and
+    // whose links are then swapped. The cells are coloured like a
+    // chessboard, so this is a bipartite matching with two partners a
+    // cell, and it fails only if no cover exists at all. The blocks it
+    // breaks become loose.
+    std::vector<size_t> loopCells;
+    std::vector<size_t> pieceOf;
+    if (!loose.empty()) {
+        std::vector<unsigned char> links(cellCnt, 0);
+        auto blockLinks = [&](size_t b) {
+            index_type tl = corner(b);
+            links[tl] = (1 << RIGHT) | (1 << DOWN);
+            links[tl + right] = (1 << LEFT) | (1 << DOWN);
+            links[tl + down] = (1 << UP) | (1 << RIGHT);
+            links[tl + down + right] = (1 << UP) | (1 << LEFT);
+        };
+        for (size_t b = 0; b < blockCnt; b++) {
+            if (freeBlock[b]) {
+                blockLinks(b);
+            }
+        }
+        auto degree = [&](index_type i) {
+            return (links[i] >> LEFT & 1) + (links[i] >> UP & 1) + (links[i] >> RIGHT & 1)
+                   + (links[i] >> DOWN & 1);
+        };
+        auto flip = [&](index_type a, index_type b) {
+            links[a] ^= 1 << map.getDirection(a, b);
+            links[b] ^= 1 << map.getDirection(b, a);
+        };
+
+        std::vector<unsigned> seen(cellCnt, 0);
+        std::vector<index_type> from(cellCnt, Point::NO_INDEX), queue;
+        unsigned stamp = 0;
+        auto augment = [&](index_type s) {
+            stamp++;
+            queue.assign(1, s);
+            seen[s] = stamp;
+            for (size_t k = 0; k < queue.size(); k++) {
+                index_type x = queue[k];
+                for (int d = LEFT; d <= DOWN; d++) {
+                    index_type y = x + adjOffset[d];
+                    if ((links[x] >> d & 1) || seen[y] == stamp || !isEmpty(y)) {
+                        continue;
+                    }
+                    seen[y] = stamp;
+                    from[y] = x;
+                    if (degree(y) < 2) {
+                        for (x = from[y]; ; x = from[y]) {
+                            flip(x, y);
+                            if (x == s) {
+                                return true;
+                            }
+                            y = from[x];
+                            flip(y, x);
+                        }
+                    }
+                    for (int e = LEFT; e <= DOWN; e++) {
+                        index_type z = y + adjOffset[e];
+                        if ((links[y] >> e & 1) && seen[z] != stamp) {
+                            seen[z] = stamp;
+                            from[z] = y;
+                            queue.push_back(z);
+                        }
+                    }
+                }
+            }
+            return false;
+        };
+        for (auto i : loose) {
+            while (degree(i) < 2) {
+                if (!augment(i)) {
+                    return false;
+                }
+            }
+        }
+
+        for (size_t b = 0; b < blockCnt; b++) {
+            if (freeBlock[b]) {
+                index_type tl = corner(b);
+                bool kept = links[tl] == ((1 << RIGHT) | (1 << DOWN))
+                            && links[tl + right] == ((1 << LEFT) | (1 << DOWN))
+                            && links[tl + down] == ((1 << UP) | (1 << RIGHT));
+                if (!kept) {
+                    freeBlock[b] = 0;
+                    loose.insert(loose.end(), {tl, tl + right, tl + down, tl + down + right});
+                }
+            }
+        }
+
+        // Step around each cycle of loose cells
+        pieceOf.assign(cellCnt, 0);
+        for (auto i : loose) {
+            if (steps[i] != NONE) {
+                continue;
+            }
+            size_t piece = blockCnt + loopCells.size();
+            index_type prev = Point::NO_INDEX, cur = i;
+            size_t len = 0;
+            do {
+                int d = LEFT;
+                while (!(links[cur] >> d & 1) || cur + adjOffset[d] == prev) {
+                    d++;
+                }
+                steps[cur] = d;
+                pieceOf[cur] = piece;
+                len++;
+                prev = cur;
+                cur += adjOffset[d];
+            } while (cur != i);
+            loopCells.push_back(len);
+        }
+    }
+
+    // Union-find of the cycles, with the cells of each root
+    size_t pieceCnt = blockCnt + loopCells.size();
+    std::vector<size_t> root(pieceCnt), cells(pieceCnt);
+    for (size_t k = blockCnt; k < pieceCnt; k++) {
+        root[k] = k;
+        cells[k] = loopCells[k - blockCnt];
+    }
+    auto find = [&](size_t b) {
+        while (root[b] != b) {
+            root[b] = root[root[b]];
+            b = root[b];
+        }
+        return b;
+    };
+
+    // An edge is stored as block * 2 with 0 to the right neighbour and
+    // 1 to the lower one. Joining two blocks redirects one cell of each:
+    // the lower right by the right edge, the lower left by the lower
+    // edge, and the top cells by the edges of the blocks to the left
+    // and above, so no cell is redirected twice.
+    auto join = [&](size_t e) {
+        size_t a = e / 2;
+        size_t b = (e % 2 == 0) ? a + 1 : a + blockCols;
+        size_t ra = find(a), rb = find(b);
+        if (ra == rb) {
+            return false;
+        }
+        root[ra] = rb;
+        cells[rb] += cells[ra];
+        index_type tl = corner(a);
+        if (e % 2 == 0) {
+            steps[tl + down + right] = RIGHT;
+            steps[tl + 2 * right] = LEFT;
+        } else {
+            steps[tl + down] = DOWN;
+            steps[tl + 2 * down + right] = UP;
+        }
+        return true;
+    };
+
+    // Every tile picks a random spanning forest of its blocks by
+    // Kruskal's algorithm. A tile only touches its own blocks, cells
+    // and union-find roots.
+    std::vector<size_t> tileFree(tileCnt, 0), tileJoined(tileCnt, 0);
+    std::vector<Random::seed_type> seeds(tileCnt);
+    for (auto &seed : seeds) {
+        seed = rng.next();
+    }
+    auto buildTile = [&](size_t t) {
+        size_t begin = tileBegin(t), end = tileBegin(t + 1);
+        std::vector<size_t> edges;
+        for (size_t b = begin; b < end; b++) {
+            root[b] = b;
+            cells[b] = 4;
+            if (!freeBlock[b]) {
+                continue;
+            }
+            tileFree[t]++;
+            if (b % blockCols + 1 < blockCols && freeBlock[b + 1]) {
+                edges.push_back(b * 2);
+            }
+            if (b + blockCols < end && freeBlock[b + blockCols]) {
+                edges.push_back(b * 2 + 1);
+            }
+        }
+        Random tileRng(seeds[t]);
+        tileRng.shuffle(edges);
+
+        // Every block is a small cycle: down, right, up, left
+        for (size_t b = begin; b < end; b++) {
+            if (freeBlock[b]) {
+                index_type tl = corner(b);
+                steps[tl] = DOWN;
+                steps[tl + down] = RIGHT;
+                steps[tl + down + right] = UP;
+                steps[tl + right] = LEFT;
+            }
+        }
+        for (auto e : edges) {
+            tileJoined[t] += join(e);
+        }
+    };
+    pool.run(tileCnt, [&](TaskPool::task_type t) {
+        buildTile(t);
+    });
+
+    size_t freeCnt = 0, joinedCnt = 0;
+    for (unsigned t = 0; t < tileCnt; t++) {
+        freeCnt += tileFree[t];
+        joinedCnt += tileJoined[t];
+    }
+
+    // Stitch the forests into one tree across the tile borders
+    std::vector<size_t> edges;
+    for (unsigned t = 1; t < tileCnt; t++) {
+        size_t begin = tileBegin(t);
+        for (size_t b = begin - blockCols; b < begin; b++) {
+            if (freeBlock[b] && freeBlock[b + blockCols]) {
+                edges.push_back(b * 2 + 1);
+            }
+        }
+    }
+    rng.shuffle(edges);
+    for (auto e : edges) {
+        joinedCnt += join(e);
+    }
+
+    // Merge the loose cycles and the block trees at the 2x2 squares
+    // where two cycles pass along facing sides in opposite directions,
+    // which become the two steps across the square. The smaller cycle
+    // is turned around first if they pass the same way. A merge adds
+    // new sides, so the squares are scanned until no merge is left.
+    size_t cycleCnt = freeCnt - joinedCnt + loopCells.size();
+    if (!loose.empty()) {
+        auto piece = [&](index_type i) {
+            size_t b = blockOf(i);
+            return find((b != blockCnt && freeBlock[b]) ? b : pieceOf[i]);
+        };
+        auto turnAround = [&](index_type start) {
+            index_type prev = start, cur = next(start);
+            while (cur != start) {
+                index_type after = next(cur);
+                linkTo(cur, prev);
+                prev = cur;
+                cur = after;
+            }
+            linkTo(start, prev);
+        };
+        auto merge = [&](index_type x0, index_type x1, index_type y0, index_type y1) {
+            size_t p = piece(x0), q = piece(y0);
+            bool xForth = next(x0) == x1, yForth = next(y0) == y1;
+            if (p == q || (!xForth && next(x1) != x0) || (!yForth && next(y1) != y0)) {
+                return false;
+            }
+            if (xForth == yForth) {
+                turnAround(cells[p] < cells[q] ? x0 : y0);
+                xForth = next(x0) == x1;
+            }
+            if (xForth) {
+                linkTo(x0, y0);
+                linkTo(y1, x1);
+            } else {
+                linkTo(x1, y1);
+                linkTo(y0, x0);
+            }
+            root[p] = q;
+            cells[q] += cells[p];
+            return true;
+        };
+
+        std::vector<index_type> squares;
+        for (auto i : loose) {
+            for (index_type tl : {i, i - right, i - down, i - down - right}) {
+                if (steps[tl] != NONE && steps[tl + right] != NONE && steps[tl + down] != NONE
+                        && steps[tl + down + right] != NONE) {
+                    squares.push_back(tl);
+                }
+            }
+        }
+        std::sort(squares.begin(), squares.end());
+        squares.erase(std::unique(squares.begin(), squares.end()), squares.end());
+        rng.shuffle(squares);
+
+        bool merged = true;
+        while (merged && cycleCnt > 1) {
+            merged = false;
+            for (auto tl : squares) {
+                index_type tr = tl + right, bl = tl + down, br = tl + down + right;
+                if (merge(tl, tr, bl, br) || merge(tl, bl, tr, br)) {
+                    cycleCnt--;
+                    merged = true;
+                }
+            }
+        }
+    }
+    if (cycleCnt != 1) {
+        std::fill(steps.begin(), steps.end(), NONE);
+        return false;
+    }
+
+    maxSequence = map.getEmptyCount() - 1;
+    numberFrom(map.randomEmpty(rng));
+    return true;
+}
+
+void Hamilton::numberFrom(const index_type& start) {
+    unsigned workerCnt = workerCount(steps.size());
+    if (workerCnt == 1) {
+        index_type cur = start;
+        for (location_type seq = 0; seq <= maxSequence; seq++) {
+            sequence[cur] = seq;
+            cur = next(cur);
+        }
+        return;
+    }
+
+    // Cut the cycle at the start and at empty cells spread over the map,
+    // flagged in the high bit of their steps. Each piece is numbered
+    // from its cut, then offset by the lengths of the pieces before it.
+    const unsigned char CUT = 0x80;
+    auto follow = [&](index_type i) {
+        return i + adjOffset[steps[i] & ~CUT];
+    };
+    size_t stride = std::max<size_t>(steps.size() / (workerCnt * 16), 1);
+    std::vector<index_type> cuts(1, start);
+    steps[start] |= CUT;
+    for (size_t i = stride; i < steps.size(); i += stride) {
+        if (steps[i] != NONE && !(steps[i] & CUT)) {
+            steps[i] |= CUT;
+            cuts.push_back(i);
+        }
     }
+    // The cut cells hold their own number until the end
+    for (size_t k = 0; k < cuts.size(); k++) {
+        sequence[cuts[k]] = k;
+    }
+
+    std::vector<location_type> length(cuts.size()), offset(cuts.size());
+    std::vector<size_t> nextCut(cuts.size());
+    TaskPool pool(workerCnt);
+    pool.run(cuts.size(), [&](TaskPool::task_type k) {
+        location_type len = 1;
+        index_type cur = follow(cuts[k]);
+        while (!(steps[cur] & CUT)) {
+            sequence[cur] = len++;
+            cur = follow(cur);
+        }
+        length[k] = len;
+        nextCut[k] = sequence[cur];
+    });
 
+    location_type seq = 0;
+    size_t k = 0;
+    do {
+        offset[k] = seq;
+        seq += length[k];
+        k = nextCut[k];
+    } while (k != 0);
+
+    pool.run(cuts.size(), [&](TaskPool::task_type k) {
+        index_type cur = cuts[k];
+        for (location_type n = 1; n < length[k]; n++) {
+            cur = follow(cur);
+            sequence[cur] += offset[k];
+        }
+    });
+    for (size_t k = 0; k < cuts.size(); k++) {
+        sequence[cuts[k]] = offset[k];
+        steps[cuts[k]] &= ~CUT;
+    }
+}
+
+void Hamilton::setThreadCount(const unsigned n) {
+    threadCnt = n;
+}
+
+unsigned Hamilton::workerCount(const size_t cellCnt) const {
+    if (cellCnt < PARALLEL_MIN_CELLS) {
+        return 1;
+    }
+    unsigned n = threadCnt ? threadCnt : std::thread::hardware_concurrency();
+    return std::max(n, 1u);
+}
+
+void Hamilton::checkFeasible(const Map& map) const {
+    size_t rows = map.getRowCount();
+    size_t columns = map.getColCount();
+    auto isEmpty = [&](index_type i) {
+        return map.getType(i) == Point::Type::EMPTY;
+    };
+
+    // Degrees and colour balance
+    index_type start = Point::NO_INDEX;
+    size_t emptyCnt = 0, blackCnt = 0;
+    for (size_t r = 1; r + 1 < rows; r++) {
+        for (size_t c = 1; c + 1 < columns; c++) {
+            index_type i = map.toIndex(Pos(r, c));
+            if (!isEmpty(i)) {
+                continue;
+            }
+            int degree = 0;
+            for (int d = LEFT; d <= DOWN; d++) {
+                degree += isEmpty(map.getAdj(i, static_cast<Direc>(d)));
+            }
+            if (degree < 2) {
+                throw std::runtime_error("Hamilton.checkFeasible(): Cell " + map.toPos(i).toString()
+                                         + " has " + intToStr(degree) + " empty neighbours");
+            }
+            if (start == Point::NO_INDEX) {
+                start = i;
+            }
+            emptyCnt++;
+            blackCnt += (r + c) % 2;
+        }
+    }
+    if (emptyCnt == 0) {
+        throw std::runtime_error("Hamilton.checkFeasible(): No empty cells");
+    }
+    if (blackCnt * 2 != emptyCnt) {
+        throw std::runtime_error("Hamilton.checkFeasible(): Colour imbalance, "
+                                 + intToStr(blackCnt) + " odd cells and "
+                                 + intToStr(emptyCnt - blackCnt) + " even cells");
+    }
+
+    // Connectivity and articulation cells by an iterative depth first
+    // search. discover[i] is the visit order from 1 and low[i] the
+    // smallest order reachable from the subtree of i by one back edge.
+    size_t cellCnt = rows * columns;
+    std::vector<index_type> discover(cellCnt, 0), low(cellCnt, 0), parent(cellCnt, Point::NO_INDEX);
+    std::vector<unsigned char> nextDirec(cellCnt, LEFT);
+    std::vector<index_type> stack;
+    stack.reserve(emptyCnt);
+
+    index_type order = 1;
+    size_t rootChildren = 0;
+    discover[start] = low[start] = order++;
+    stack.push_back(start);
+    while (!stack.empty()) {
+        index_type cur = stack.back();
+        if (nextDirec[cur] <= DOWN) {
+            index_type adj = map.getAdj(cur, static_cast<Direc>(nextDirec[cur]++));
+            if (!isEmpty(adj)) {
+                continue;
+            }
+            if (discover[adj] == 0) {
+                parent[adj] = cur;
+                discover[adj] = low[adj] = order++;
+                stack.push_back(adj);
+                if (cur == start) {
+                    rootChildren++;
+                }
+            } else if (adj != parent[cur]) {
+                low[cur] = std::min(low[cur], discover[adj]);
+            }
+            continue;
+        }
+
+        // All neighbours done, pass the low value up to the parent
+        stack.pop_back();
+        index_type p = parent[cur];
+        if (p == Point::NO_INDEX) {
+            continue;
+        }
+        low[p] = std::min(low[p], low[cur]);
+        if (p != start && low[cur] >= discover[p]) {
+            throw std::runtime_error("Hamilton.checkFeasible(): Cell " + map.toPos(p).toString()
+                                     + " separates the empty cells");
+        }
+    }
+    if (rootChildren > 1) {
+        throw std::runtime_error("Hamilton.checkFeasible(): Cell " + map.toPos(start).toString()
+                                 + " separates the empty cells");
+    }
+    if (order - 1 != emptyCnt) {
+        throw std::runtime_error("Hamilton.checkFeasible(): Empty cells are split into several regions, "
+                                 + intToStr(order - 1) + " of " + intToStr(emptyCnt)
+                                 + " are reachable from " + map.toPos(start).toString());
+    }
+}
+
+void Hamilton::generateBySearch(const Map& map, SearchContext& ctx, Random& rng) {
     // Get two empty spaces from map
-    std::vector<Pos> empty;
-    map.getEmptyPoints(empty);
-
-    Pos first = map.randomEmpty();
-    Pos second;
-    for (auto p : first.getAllAdjPos()) {
-        if (std::count(empty.begin(), empty.end(), p) == 1) {
-            second = p;
+    index_type first = map.randomEmpty(rng);
+    index_type second = Point::NO_INDEX;
+    for (int d = LEFT; d <= DOWN; d++) {
+        index_type adj = map.getAdj(first, static_cast<Direc>(d));
+        if (map.isInside(adj) && map.getType(adj) == Point::Type::EMPTY) {
+            second = adj;
             break;
         }
     }
-    assert(first.getDirectionTo(second) != NONE);
+    assert(map.getDirection(first, second) != NONE);
 
-    std::list<Direc> path;
-    map.findMaxPath(first, second, first.getDirectionTo(second), path);
+    Path path;
+    map.findMaxPath(first, second, map.getDirection(first, second), ctx, path);
 
     uint seq = 0;
-    Pos cur = first;
+    index_type cur = first;
     for (auto d: path) {
-        size_t i = cur.getX();
-        size_t j = cur.getY();
-        steps[i][j] = d;
-        sequence[i][j] = ++seq;
+        steps[cur] = d;
+        sequence[cur] = ++seq;
 
-        cur = cur.getAdjPos(d);
+        cur += adjOffset[d];
     }
-    steps[second.getX()][second.getY()] = second.getDirectionTo(first);
-    sequence[second.getX()][second.getY()] = 0;
+    steps[second] = map.getDirection(second, first);
+    sequence[second] = 0;
 
     maxSequence = seq;
-    if (maxSequence+1 != empty.size()) {
-        throw std::runtime_error("Unable to generate covering hamilton path");
+    if (maxSequence+1 != map.getEmptyCount()) {
+        throw std::runtime_error("Hamilton.generate(): Unable to generate covering hamilton path");
+    }
+}
+
+Hamilton::location_type Hamilton::reroute(const index_type& head, const index_type& tail,
+                                          const index_type& food) {
+    location_type total = maxSequence + 1;
+    auto rel = [&](const index_type i) {
+        return (sequence[i] + total - sequence[head]) % total;
+    };
+    // Offsets to both sides of the step out of a cell
+    auto sides = [&](const index_type i) {
+        if (steps[i] == LEFT || steps[i] == RIGHT) {
+            return std::array<Map::offset_type, 2>{{adjOffset[UP], adjOffset[DOWN]}};
+        } else {
+            return std::array<Map::offset_type, 2>{{adjOffset[LEFT], adjOffset[RIGHT]}};
+        }
+    };
+
+    location_type moved = 0;
+    for (int round = 0; round < MAX_REROUTE_ROUNDS; round++) {
+        location_type f = rel(food), t = rel(tail);
+        if (f < 3 || f >= t) {
+            break;
+        }
+
+        // A step p -> q between the food and the tail can take in a piece
+        // before the food at a square where the piece steps r -> s the
+        // other way. handleAt[rel(r)] keeps p.
+        std::fill(handleAt.begin(), handleAt.begin() + f, Point::NO_INDEX);
+        index_type p = food;
+        for (location_type k = f; k < t; k++) {
+            index_type q = next(p);
+            for (auto o : sides(p)) {
+                index_type s = p + o, r = q + o;
+                if (next(r) == s && rel(r) > 0 && rel(r) + 1 < f) {
+                    handleAt[rel(r)] = p;
+                }
+            }
+            p = q;
+        }
+        // nearHandle[k] is the first place from k on with a handle
+        nearHandle[f] = f;
+        for (location_type k = f; k-- > 0; ) {
+            nearHandle[k] = (handleAt[k] != Point::NO_INDEX) ? k : nearHandle[k + 1];
+        }
+
+        // A piece b .. d before the food can be cut off at a square where
+        // the cycle steps a -> b and d -> c the other way. Take the longest
+        // one holding a handle.
+        index_type bestA = Point::NO_INDEX, bestD = Point::NO_INDEX;
+        location_type bestLen = 0, bestHandle = 0;
+        index_type a = head;
+        for (location_type k = 0; k + 2 < f; k++) {
+            index_type b = next(a);
+            for (auto o : sides(a)) {
+                index_type c = a + o, d = b + o;
+                if (next(d) != c) {
+                    continue;
+                }
+                location_type dLoc = rel(d), h = nearHandle[k + 1];
+                if (k < dLoc && dLoc < f && h < dLoc && dLoc - k > bestLen) {
+                    bestA = a;
+                    bestD = d;
+                    bestLen = dLoc - k;
+                    bestHandle = h;
+                }
+            }
+            a = b;
+        }
+        if (bestA == Point::NO_INDEX) {
+            break;
+        }
+
+        // Cut the piece into a cycle of its own and splice it in
+        p = handleAt[bestHandle];
+        index_type b = next(bestA), c = next(bestD), q = next(p), r = Point::NO_INDEX;
+        for (auto o : sides(p)) {
+            if (rel(q + o) == bestHandle && next(q + o) == p + o) {
+                r = q + o;
+            }
+        }
+        index_type s = next(r);
+        linkTo(bestA, c);
+        linkTo(bestD, b);
+        linkTo(r, q);
+        linkTo(p, s);
+
+        // Only the cells from a to q change places
+        location_type seq = sequence[bestA];
+        for (index_type cur = next(bestA); cur != q; cur = next(cur)) {
+            seq = (seq == maxSequence) ? 0 : seq + 1;
+            sequence[cur] = seq;
+        }
+        moved += bestLen;
+    }
+    return moved;
+}
+
+void Hamilton::linkTo(const index_type& from, const index_type& to) {
+    for (int d = LEFT; d <= DOWN; d++) {
+        if (from + adjOffset[d] == to) {
+            steps[from] = d;
+            return;
+        }
     }
 }
 
-Pos Hamilton::next(const Pos& pos) const {
-    return pos.getAdjPos(steps[pos.getX()][pos.getY()]);
+Hamilton::index_type Hamilton::next(const index_type& i) const {
+    return i + adjOffset[steps[i]];
 }
 
-Hamilton::location_type Hamilton::location(const Pos& anchor, const Pos& a) const {
-    int anchorD = sequence[anchor.getX()][anchor.getY()];
-    int aD = sequence[a.getX()][a.getY()];
+Hamilton::location_type Hamilton::location(const index_type& anchor, const index_type& a) const {
+    location_type anchorD = sequence[anchor];
+    location_type aD = sequence[a];
 
+    // The cycle has maxSequence + 1 cells
     if (aD < anchorD) {
-        aD += maxSequence;
+        aD += maxSequence + 1;
     }
     return aD;
 }
 
 std::ostream& operator<<(std::ostream& out, const Hamilton& h) {
-    for (size_t i = 0; i < h.steps.size(); i++) {
-        for (size_t j = 0; j < h.steps[0].size(); j++) {
-            switch (h.steps[i][j]) {
+    for (size_t i = 0; i < h.steps.size(); i += h.colCnt) {
+        for (size_t j = 0; j < h.colCnt; j++) {
+            switch (h.steps[i + j]) {
             case RIGHT:
                 out << std::string(">");
                 break;
@@ -94,9 +947,9 @@ std::ostream& operator<<(std::ostream& out, const Hamilton& h) {
     }
     out << std::endl;
 
-    for (size_t i = 0; i < h.sequence.size(); i++) {
-        for (size_t j = 0; j < h.sequence[0].size(); j++) {
-            out << h.sequence[i][j] << ",";
+    for (size_t i = 0; i < h.sequence.size(); i += h.colCnt) {
+        for (size_t j = 0; j < h.colCnt; j++) {
+            out << h.sequence[i + j] << ",";
         }
         out << std::endl;
     }
@@ -1,40 +1,125 @@
 #include "Map.h"
-#include "GameCtrl.h"
-#include "Console.h"
 #include <algorithm>
-#include <queue>
 #include <cmath>
 
 using std::vector;
 using std::string;
-using std::list;
-using std::queue;
+
+const Map::index_type Map::NO_SLOT;
 
 Map::Map(const size_type &rowCnt_, const size_type &colCnt_)
-    : content(rowCnt_, vector<Point>(colCnt_)) {
+    : rowCnt(rowCnt_), colCnt(colCnt_),
+      content(rowCnt_ * colCnt_, point_type::EMPTY) {
+    // Index offsets of the neighbours
+    offset_type cols_ = static_cast<offset_type>(colCnt);
+    adjOffset[NONE] = 0;
+    adjOffset[LEFT] = -1;
+    adjOffset[UP] = -cols_;
+    adjOffset[RIGHT] = 1;
+    adjOffset[DOWN] = cols_;
+
     // Add boundary walls
     auto rows = getRowCount(), cols = getColCount();
     for (size_type i = 0; i < rows; ++i) {
         if (i == 0 || i == rows - 1) {  // The first and last row
             for (size_type j = 0; j < cols; ++j) {
-                content[i][j].setType(point_type::WALL);
+                content[i * cols + j] = point_type::WALL;
             }
         } else {  // Rows in the middle
-            content[i][0].setType(point_type::WALL);
-            content[i][cols - 1].setType(point_type::WALL);
+            content[i * cols] = point_type::WALL;
+            content[i * cols + cols - 1] = point_type::WALL;
+        }
+    }
+
+    // Build the empty cell list and the type counters
+    emptySlot.assign(content.size(), NO_SLOT);
+    emptyCells.reserve(content.size());
+    for (index_type i = 0; i < content.size(); ++i) {
+        if (content[i] == point_type::EMPTY) {
+            addEmpty(i);
         }
+        ++typeCnt[content[i]];
     }
 }
 
 Map::~Map() {
 }
 
-Point& Map::getPoint(const Pos &p) {
-    return content[p.getX()][p.getY()];
+Map::index_type Map::toIndex(const Pos &p) const {
+    return static_cast<index_type>(p.getX() * colCnt + p.getY());
+}
+
+Pos Map::toPos(const index_type &i) const {
+    return Pos(i / colCnt, i % colCnt);
+}
+
+Map::offset_type Map::getAdjOffset(const Direc &d) const {
+    return adjOffset[d];
+}
+
+Map::index_type Map::getAdj(const index_type &i, const Direc &d) const {
+    return i + adjOffset[d];
+}
+
+Direc Map::getDirection(const index_type &from, const index_type &to) const {
+    // Unsigned wrap-around turns negative offsets into large differences
+    index_type diff = to - from;
+    for (int d = LEFT; d <= DOWN; ++d) {
+        if (diff == static_cast<index_type>(adjOffset[d])) {
+            return static_cast<Direc>(d);
+        }
+    }
+    return NONE;
+}
+
+Map::point_type Map::getType(const index_type &i) const {
+    return static_cast<point_type>(content[i]);
+}
+
+Map::point_type Map::getType(const Pos &p) const {
+    return getType(toIndex(p));
 }
 
-const Point& Map::getPoint(const Pos &p) const {
-    return content[p.getX()][p.getY()];
+void Map::setType(const Pos &p, const point_type &t) {
+    setType(toIndex(p), t);
+}
+
+void Map::setType(const index_type &i, const point_type &t) {
+    auto old = content[i];
+    content[i] = static_cast<cell_type>(t);
+    --typeCnt[old];
+    ++typeCnt[t];
+    if (useBitboard) {
+        freeBits.set(toPos(i), isFreeType(t));
+    }
+    if (useFoodDist && hasFood()) {
+        bool wasFree = isFreeType(old) || old == point_type::FOOD;
+        if (wasFree && !isFieldFree(i)) {
+            blockFoodDist(i);
+        } else if (!wasFree && isFieldFree(i)) {
+            unblockFoodDist(i);
+        }
+    }
+    if (old == point_type::EMPTY && t != point_type::EMPTY) {
+        removeEmpty(i);
+    } else if (old != point_type::EMPTY && t == point_type::EMPTY) {
+        addEmpty(i);
+    }
+}
+
+void Map::addEmpty(const index_type &i) {
+    emptySlot[i] = static_cast<index_type>(emptyCells.size());
+    emptyCells.push_back(i);
+}
+
+void Map::removeEmpty(const index_type &i) {
+    // Swap the last cell into the removed slot
+    auto slot = emptySlot[i];
+    auto last = emptyCells.back();
+    emptyCells[slot] = last;
+    emptySlot[last] = slot;
+    emptyCells.pop_back();
+    emptySlot[i] = NO_SLOT;
 }
 
 bool Map::isInside(const Pos &p) const {
@@ -43,290 +128,731 @@ bool Map::isInside(const Pos &p) const {
         && p.getY() < (Pos::attr_type)getColCount() - 1;
 }
 
-bool Map::isSafe(const Pos &p) const {
-    return isInside(p) 
-        && (getPoint(p).getType() == point_type::EMPTY
-        || getPoint(p).getType() == point_type::FOOD);
+bool Map::isInside(const index_type &i) const {
+    return i < content.size() && isInside(toPos(i));
+}
+
+bool Map::isSafe(const index_type &i) const {
+    auto type = content[i];
+    return type == point_type::EMPTY || type == point_type::FOOD;
+}
+
+bool Map::isHead(const index_type &i) const {
+    return content[i] == point_type::SNAKE_HEAD;
 }
 
-bool Map::isHead(const Pos &p) const {
-    return isInside(p) && content[p.getX()][p.getY()].getType() == point_type::SNAKE_HEAD;
+bool Map::isTail(const index_type &i) const {
+    return content[i] == point_type::SNAKE_TAIL;
 }
 
-bool Map::isTail(const Pos &p) const {
-    return isInside(p) && content[p.getX()][p.getY()].getType() == point_type::SNAKE_TAIL;
+bool Map::isFreeType(const cell_type &t) {
+    return t == point_type::EMPTY || t >= point_type::TEST_VISIT;
 }
 
-bool Map::isEmpty(const Pos &p) const {
-    return isInside(p) && (content[p.getX()][p.getY()].getType() == point_type::EMPTY
-                           || content[p.getX()][p.getY()].getType() >= point_type::TEST_VISIT);
+bool Map::isEmpty(const index_type &i) const {
+    return isFreeType(content[i]);
 }
 
 bool Map::isAllBody() const {
-    auto rows = getRowCount(), cols = getColCount();
-    for (size_type i = 0; i < rows; ++i) {
-        for (size_type j = 0; j < cols; ++j) {
-            auto type = content[i][j].getType();
-            if (!(type == point_type::SNAKE_HEAD
-                || type == point_type::SNAKE_BODY
-                || type == point_type::SNAKE_TAIL
-                || type == point_type::WALL)) {
-                return false;
-            }
-        }
-    }
-    return true;
+    return typeCnt[point_type::SNAKE_HEAD] + typeCnt[point_type::SNAKE_BODY]
+        + typeCnt[point_type::SNAKE_TAIL] + typeCnt[point_type::WALL] == content.size();
+}
+
+Map::size_type Map::getTypeCount(const point_type &t) const {
+    return typeCnt[t];
 }
 
 void Map::getEmptyPoints(vector<Pos> &res) const {
     res.clear();
-    auto rows = getRowCount(), cols = getColCount();
-    for (size_type i = 1; i < rows - 1; ++i) {
-        for (size_type j = 1; j < cols - 1; ++j) {
-            if (content[i][j].getType()
-                == point_type::EMPTY) {
-                res.push_back(Pos(i, j));
-            }
-        }
+    res.reserve(emptyCells.size());
+    for (const auto &i : emptyCells) {
+        res.push_back(toPos(i));
     }
 }
 
-Pos Map::randomEmpty() const {
-    vector<Pos> emptyPoints;
-    getEmptyPoints(emptyPoints);
-    if (!emptyPoints.empty()) {
-        return emptyPoints[random(0, emptyPoints.size() - 1)];
+Map::size_type Map::getEmptyCount() const {
+    return typeCnt[point_type::EMPTY];
+}
+
+Map::index_type Map::randomEmpty(Random &rng) const {
+    if (!emptyCells.empty()) {
+        return emptyCells[rng.below(emptyCells.size())];
     } else {
-        return Pos::INVALID;
+        return Point::NO_INDEX;
     }
 }
 
-void Map::createRandFood() {
-    Pos p = randomEmpty();
-    if (p != Pos::INVALID) {
-        createFood(p);
+void Map::createRandFood(Random &rng) {
+    auto i = randomEmpty(rng);
+    if (i != Point::NO_INDEX) {
+        createFood(i);
     }
 }
 
-void Map::createFood(const Pos &pos) {
-    food = pos;
-    content[food.getX()][food.getY()].setType(point_type::FOOD);
+void Map::createFood(const index_type &i) {
+    food = i;
+    setType(food, point_type::FOOD);
+    if (useFoodDist) {
+        rebuildFoodDist();
+    }
 }
 
 void Map::removeFood() {
-    if (food != Pos::INVALID) {
-        content[food.getX()][food.getY()].setType(point_type::EMPTY);
-        food = Pos::INVALID;
+    if (food != Point::NO_INDEX) {
+        setType(food, point_type::EMPTY);
+        food = Point::NO_INDEX;
     }
 }
 
 bool Map::hasFood() const {
-    return food != Pos::INVALID;
+    return food != Point::NO_INDEX;
 }
 
 Map::size_type Map::getRowCount() const {
-    return content.size();
+    return rowCnt;
 }
 
 Map::size_type Map::getColCount() const {
-    return content[0].size();
+    return colCnt;
 }
 
-const Pos& Map::getFood() const {
+const Map::cell_type* Map::getCells() const {
+    return content.data();
+}
+
+Map::index_type Map::getFood() const {
     return food;
 }
 
-void Map::setShowSearchDetails(const bool &b) {
-    showSearchDetails = b;
+void Map::setUseBitboard(const bool &b) {
+    useBitboard = b;
+    if (useBitboard) {
+        freeBits.resize(rowCnt, colCnt);
+        for (size_type i = 0; i < content.size(); ++i) {
+            if (isFreeType(content[i])) {
+                freeBits.set(toPos(i), true);
+            }
+        }
+    } else {
+        freeBits.resize(0, 0);
+    }
 }
 
-Point::value_type Map::estimateDist(const Pos &from, const Pos &to) {
-    auto dx = fabs(from.getX() - to.getX());
-    auto dy = fabs(from.getY() - to.getY());
-    return dx + dy;
+void Map::setUseFoodDist(const bool &b) {
+    useFoodDist = b;
+    if (useFoodDist) {
+        auto n = content.size();
+        foodDist.assign(n, INF);
+        fieldAffected.reserve(n);
+        fieldSeeds.reserve(n);
+        fieldOpen.reserve(n);
+        fieldMark.assign(n, 0);
+        fieldGen = 0;
+        rebuildFoodDist();
+    } else {
+        foodDist.clear();
+        fieldMark.clear();
+    }
 }
 
-void Map::showPosSearchDetail(const Pos &p, const point_type &t) {
-    getPoint(p).setType(t);
-    GameCtrl::getInstance()->sleepFor(detailInterval);
+bool Map::isUseFoodDist() const {
+    return useFoodDist;
 }
 
-void Map::showVisitPosIfNeed(const Pos &n) {
-    if (showSearchDetails) {
-        if (getPoint(n).getType() != point_type::TEST_PATH) {
-            showPosSearchDetail(n, point_type::TEST_VISIT);
+Point::value_type Map::getFoodDist(const index_type &i) const {
+    return useFoodDist && hasFood() ? foodDist[i] : INF;
+}
+
+Direc Map::getFoodDirec(const index_type &from, const Direc &initDirec) const {
+    if (!useFoodDist || !hasFood()) {
+        return NONE;
+    }
+    Direc direcs[4] = {LEFT, UP, RIGHT, DOWN};
+    if (initDirec != NONE) {
+        std::swap(direcs[0], direcs[initDirec - 1]);
+    }
+    Direc res = NONE;
+    Point::value_type best = INF;
+    for (const auto &d : direcs) {
+        auto dist = foodDist[from + adjOffset[d]];
+        if (dist < best) {
+            best = dist;
+            res = d;
         }
     }
+    return res;
 }
 
-void Map::showPathIfNeed(const Pos &start, const list<Direc> &path) {
-    if (showSearchDetails) {
-        auto tmp = start;
-        for (const auto &d : path) {
-            showPosSearchDetail(tmp, point_type::TEST_PATH);
-            tmp = tmp.getAdjPos(d);
+bool Map::isFieldFree(const index_type &i) const {
+    return isFreeType(content[i]) || content[i] == point_type::FOOD;
+}
+
+void Map::rebuildFoodDist() {
+    std::fill(foodDist.begin(), foodDist.end(), INF);
+    if (!hasFood()) {
+        return;
+    }
+    foodDist[food] = 0;
+    fieldOpen.clear();
+    fieldOpen.push_back(food);
+    for (size_type head = 0; head < fieldOpen.size(); ++head) {
+        auto cur = fieldOpen[head];
+        for (int d = LEFT; d <= DOWN; ++d) {
+            auto adj = cur + adjOffset[d];
+            if (foodDist[adj] == INF && isFieldFree(adj)) {
+                foodDist[adj] = foodDist[cur] + 1;
+                fieldOpen.push_back(adj);
+            }
         }
-        showPosSearchDetail(tmp, point_type::TEST_PATH);
     }
 }
 
-void Map::constructPath(const Pos &from, const Pos &to, list<Direc> &path) const {
-    Pos tmp = to, parent;
-    while (tmp != Pos::INVALID && tmp != from) {
-        parent = getPoint(tmp).getParent();
-        path.push_front(parent.getDirectionTo(tmp));
-        tmp = parent;
+void Map::blockFoodDist(const index_type &c) {
+    if (foodDist[c] == INF) {
+        return;  // No path passed through it
+    }
+    if (++fieldGen == 0) {
+        std::fill(fieldMark.begin(), fieldMark.end(), 0);
+        fieldGen = 1;
+    }
+
+    // Collect the affected cells in increasing distance. A cell is
+    // affected if none of its neighbours one step closer to the food
+    // is unaffected. All affected cells of a layer are known before
+    // the layer is scanned, so each cell is decided once.
+    fieldAffected.clear();
+    fieldAffected.push_back(c);
+    fieldMark[c] = fieldGen;
+    for (size_type head = 0; head < fieldAffected.size(); ++head) {
+        auto u = fieldAffected[head];
+        for (int d = LEFT; d <= DOWN; ++d) {
+            auto v = u + adjOffset[d];
+            if (fieldMark[v] == fieldGen || foodDist[v] != foodDist[u] + 1) {
+                continue;
+            }
+            bool supported = false;
+            for (int e = LEFT; e <= DOWN; ++e) {
+                auto w = v + adjOffset[e];
+                if (fieldMark[w] != fieldGen && foodDist[w] == foodDist[v] - 1) {
+                    supported = true;
+                    break;
+                }
+            }
+            if (!supported) {
+                fieldMark[v] = fieldGen;
+                fieldAffected.push_back(v);
+            }
+        }
+    }
+    for (const auto &v : fieldAffected) {
+        foodDist[v] = INF;
+    }
+
+    // Seed the affected cells from their unaffected neighbours
+    fieldSeeds.clear();
+    for (size_type k = 1; k < fieldAffected.size(); ++k) {
+        auto v = fieldAffected[k];
+        for (int d = LEFT; d <= DOWN; ++d) {
+            auto w = v + adjOffset[d];
+            if (fieldMark[w] != fieldGen && foodDist[w] != INF
+                    && foodDist[w] + 1 < foodDist[v]) {
+                foodDist[v] = foodDist[w] + 1;
+            }
+        }
+        if (foodDist[v] != INF) {
+            fieldSeeds.push_back(v);
+        }
+    }
+    std::sort(fieldSeeds.begin(), fieldSeeds.end(), [this](const index_type &a, const index_type &b) {
+        return foodDist[a] < foodDist[b];
+    });
+
+    // Propagate in increasing distance by merging the sorted seeds
+    // with a breadth-first queue
+    fieldOpen.clear();
+    size_type seedHead = 0, openHead = 0;
+    while (seedHead < fieldSeeds.size() || openHead < fieldOpen.size()) {
+        index_type u;
+        if (openHead < fieldOpen.size() && (seedHead == fieldSeeds.size()
+                || foodDist[fieldOpen[openHead]] <= foodDist[fieldSeeds[seedHead]])) {
+            u = fieldOpen[openHead++];
+        } else {
+            u = fieldSeeds[seedHead++];
+        }
+        for (int d = LEFT; d <= DOWN; ++d) {
+            auto v = u + adjOffset[d];
+            if (fieldMark[v] == fieldGen && v != c && foodDist[u] + 1 < foodDist[v]) {
+                foodDist[v] = foodDist[u] + 1;
+                fieldOpen.push_back(v);
+            }
+        }
     }
 }
 
-void Map::initMin() {
-    auto rows = getRowCount(), cols = getColCount();
-    for (size_type i = 1; i < rows - 1; ++i) {
-        for (size_type j = 1; j < cols - 1; ++j) {
-            content[i][j].setDist(INF);
-            Pos p(i, j);
-            content[i][j].setPos(p);
+void Map::unblockFoodDist(const index_type &c) {
+    for (int d = LEFT; d <= DOWN; ++d) {
+        auto w = c + adjOffset[d];
+        if (foodDist[w] != INF && foodDist[w] + 1 < foodDist[c]) {
+            foodDist[c] = foodDist[w] + 1;
+        }
+    }
+    if (foodDist[c] == INF) {
+        return;
+    }
+    fieldOpen.clear();
+    fieldOpen.push_back(c);
+    for (size_type head = 0; head < fieldOpen.size(); ++head) {
+        auto u = fieldOpen[head];
+        for (int d = LEFT; d <= DOWN; ++d) {
+            auto v = u + adjOffset[d];
+            if (foodDist[u] + 1 < foodDist[v] && isFieldFree(v)) {
+                foodDist[v] = foodDist[u] + 1;
+                fieldOpen.push_back(v);
+            }
         }
     }
 }
 
-void Map::initMax() {
-    auto rows = getRowCount(), cols = getColCount();
-    for (size_type i = 1; i < rows - 1; ++i) {
-        for (size_type j = 1; j < cols - 1; ++j) {
-            content[i][j].setVisit(false);
+bool Map::isReachable(const index_type &from, const index_type &to, SearchContext &ctx) const {
+    if (!useBitboard) {
+        return true;
+    }
+    ctx.resize(rowCnt, colCnt);
+    Bitboard &reach = ctx.getReach();
+    if (!freeBits.floodFill(toPos(from), reach, maxFillSweeps())) {
+        // Winding region, leave it to the search
+        return true;
+    }
+    if (reach.test(toPos(to))) {
+        return true;
+    }
+    // The goal may be of any type, so it's entered from a reached cell
+    for (int d = LEFT; d <= DOWN; ++d) {
+        if (reach.test(toPos(to + adjOffset[d]))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Map::size_type Map::countFreeRegion(const index_type &from, SearchContext &ctx) const {
+    ctx.resize(rowCnt, colCnt);
+    if (useBitboard) {
+        Bitboard &reach = ctx.getReach();
+        if (freeBits.floodFill(toPos(from), reach, maxFillSweeps())) {
+            return reach.count() - 1;
+        }
+    }
+
+    // Fall back to a breadth-first traversal
+    ctx.initMin();
+    ctx.setDist(from, 0);
+    auto &openList = ctx.getOpenList();
+    openList.clear();
+    openList.push_back(from);
+    size_type cnt = 0;
+    for (size_type head = 0; head < openList.size(); ++head) {
+        auto cur = openList[head];
+        for (int d = LEFT; d <= DOWN; ++d) {
+            auto adj = cur + adjOffset[d];
+            if (isEmpty(adj) && ctx.getDist(adj) == INF) {
+                ctx.setDist(adj, ctx.getDist(cur) + 1);
+                openList.push_back(adj);
+                ++cnt;
+            }
         }
     }
+    return cnt;
+}
+
+Bitboard::size_type Map::maxFillSweeps() const {
+    Bitboard::size_type words = rowCnt * ((colCnt + Bitboard::WORD_BITS - 1) / Bitboard::WORD_BITS);
+    return std::max<Bitboard::size_type>(2, getEmptyCount() / words / 2);
+}
+
+Point::value_type Map::estimateDist(const Pos &from, const Pos &to) {
+    auto dx = fabs(from.getX() - to.getX());
+    auto dy = fabs(from.getY() - to.getY());
+    return dx + dy;
+}
+
+void Map::constructPath(const index_type &from, const index_type &to, const SearchContext &ctx,
+                        Path &path) const {
+    auto tmp = to;
+    while (tmp != Point::NO_INDEX && tmp != from) {
+        auto parent = ctx.getParent(tmp);
+        path.push_front(getDirection(parent, tmp));
+        tmp = parent;
+    }
 }
 
-void Map::findMinPath(const Pos &from, const Pos &to, const Direc &initDirec, list<Direc> &path) {
+void Map::showPathIfNeed(SearchContext &ctx, const index_type &from, const Path &path) const {
+    if (ctx.isShowSearchDetails()) {
+        auto tmp = from;
+        for (const auto &d : path) {
+            ctx.showPosSearchDetail(tmp, point_type::TEST_PATH);
+            tmp = getAdj(tmp, d);
+        }
+        ctx.showPosSearchDetail(tmp, point_type::TEST_PATH);
+    }
+}
+
+void Map::findMinPath(const index_type &from, const index_type &to, const Direc &initDirec,
+                      SearchContext &ctx, Path &path, const SearchAlgo &algo) const {
     if (!isInside(from) || !isInside(to)) {
+        path.clear();
+        return;
+    }
+    if (algo == TIMED) {
+        // Cells blocked now may be entered, so no reachability check
+        searchMinPath(from, to, initDirec, ctx, path, true);
+        return;
+    }
+    if (!isReachable(from, to, ctx)) {
+        path.clear();
         return;
     }
+    if (algo == ASTAR) {
+        searchAStar(from, to, initDirec, ctx, path);
+    } else if (algo == BIBFS) {
+        searchBidirectional(from, to, initDirec, ctx, path);
+    } else {
+        searchMinPath(from, to, initDirec, ctx, path);
+    }
+}
+
+void Map::searchMinPath(const index_type &from, const index_type &to, const Direc &initDirec,
+                        SearchContext &ctx, Path &path, const bool timed) const {
 
     // Prepare work for searching
-    initMin();
+    ctx.resize(rowCnt, colCnt);
+    ctx.initMin();
     path.clear();
-    getPoint(from).setDist(0);
-    queue<Pos> openList;
-    openList.push(from);
+    ctx.setDist(from, 0);
+    auto &openList = ctx.getOpenList();
+    openList.clear();
+    openList.push_back(from);
 
     // Start BFS
-    while (!openList.empty()) {
+    size_type head = 0;
+    for (; head < openList.size(); ++head) {
 
-        // Get current search point
-        Pos curPos = openList.front();
-        Point curPoint = getPoint(curPos);
-        openList.pop();
-        showVisitPosIfNeed(curPos);
+        // Get current search cell
+        auto cur = openList[head];
+        ctx.showVisitPosIfNeed(cur);
 
         // Check if the goal is found
-        if (curPos == to) {
-            constructPath(from, to, path);
-            showPathIfNeed(from, path);
+        if (cur == to) {
+            constructPath(from, to, ctx, path);
+            showPathIfNeed(ctx, from, path);
+            ++head;
             break;
         }
 
         // Arrange the order of traversing to make the result path as straight as possible
-        Direc bestDirec = (curPos == from ? initDirec : curPoint.getParent().getDirectionTo(curPos));
-        auto adjPositions = curPos.getAllAdjPos();
-        for (unsigned i = 0; i < adjPositions.size(); ++i) {
-            if (bestDirec == curPos.getDirectionTo(adjPositions[i])) {
-                std::swap(adjPositions[0], adjPositions[i]);
+        Direc bestDirec = (cur == from ? initDirec : getDirection(ctx.getParent(cur), cur));
+        Direc direcs[4] = {LEFT, UP, RIGHT, DOWN};
+        if (bestDirec != NONE) {
+            std::swap(direcs[0], direcs[bestDirec - 1]);
+        }
+
+        // Traverse adjacent cells
+        auto adjDist = ctx.getDist(cur) + 1;
+        for (const auto &d : direcs) {
+            auto adj = cur + adjOffset[d];
+            bool free = isEmpty(adj) || adj == to || (timed && ctx.getFreeTime(adj) <= adjDist);
+            if (free && ctx.getDist(adj) == INF
+                    && ctx.isVisit(adj) == false) {
+
+                if (cur == from && ctx.isVisit(cur) == true
+                        && adj == to) {
+                    continue; // Don't allow super-short solutions
+                }
+
+                ctx.setParent(adj, cur);
+                ctx.setDist(adj, adjDist);
+                openList.push_back(adj);
+            }
+        }
+    }
+    ctx.setExpandCount(head);
+}
+
+void Map::searchAStar(const index_type &from, const index_type &to, const Direc &initDirec,
+                      SearchContext &ctx, Path &path) const {
+
+    // Prepare work for searching
+    ctx.resize(rowCnt, colCnt);
+    ctx.initMin();
+    path.clear();
+    ctx.setDist(from, 0);
+
+    // Bucket k holds the nodes with f = h(from) + 2k
+    Pos goal = toPos(to);
+    auto h0 = estimateDist(toPos(from), goal);
+    ctx.clearBuckets();
+    ctx.pushBucket(0, from);
+    size_type expandCnt = 0;
+
+    // Start A*
+    bool found = false;
+    index_type cur;
+    for (size_type k = 0; k < ctx.getBucketCount() && !found; ++k) {
+        while (ctx.popBucket(k, cur)) {
+
+            // Get current search cell, skipping the ones reopened
+            // with a smaller f
+            Pos curPos = toPos(cur);
+            auto g = ctx.getDist(cur);
+            if (g + estimateDist(curPos, goal) != h0 + 2 * (Point::value_type)k) {
+                continue;
+            }
+            ctx.showVisitPosIfNeed(cur);
+            ++expandCnt;
+
+            // Check if the goal is found
+            if (cur == to) {
+                constructPath(from, to, ctx, path);
+                showPathIfNeed(ctx, from, path);
+                found = true;
                 break;
             }
+
+            // Arrange the order of traversing to make the result path as straight as possible.
+            // The best direction is pushed last so that it's popped first.
+            Direc bestDirec = (cur == from ? initDirec : getDirection(ctx.getParent(cur), cur));
+            Direc direcs[4] = {LEFT, UP, RIGHT, DOWN};
+            if (bestDirec != NONE) {
+                std::swap(direcs[0], direcs[bestDirec - 1]);
+            }
+
+            // Traverse adjacent cells
+            for (int j = 3; j >= 0; --j) {
+                auto adj = cur + adjOffset[direcs[j]];
+                if ((isEmpty(adj) || adj == to) && g + 1 < ctx.getDist(adj)
+                        && ctx.isVisit(adj) == false) {
+
+                    if (cur == from && ctx.isVisit(cur) == true
+                            && adj == to) {
+                        continue; // Don't allow super-short solutions
+                    }
+
+                    ctx.setParent(adj, cur);
+                    ctx.setDist(adj, g + 1);
+                    auto f = g + 1 + estimateDist(curPos.getAdjPos(direcs[j]), goal);
+                    ctx.pushBucket((f - h0) / 2, adj);
+                }
+            }
         }
+    }
+    ctx.setExpandCount(expandCnt);
+}
 
-        // Traverse adjacent positions
-        for (const auto &adjPos : adjPositions) {
-            Point &adjPoint = getPoint(adjPos);
-            if (isEmpty(adjPos) && adjPoint.getDist() == INF
-                    && adjPoint.isVisit() == false) {
+void Map::searchBidirectional(const index_type &from, const index_type &to, const Direc &initDirec,
+                              SearchContext &ctx, Path &path) const {
 
-                if (curPos == from && curPoint.isVisit() == true
-                        && adjPos == to) {
+    // Prepare work for searching
+    ctx.resize(rowCnt, colCnt);
+    ctx.initMin();
+    path.clear();
+    ctx.setExpandCount(0);
+    if (from == to) {
+        return;
+    }
+    ctx.setDist(from, 0);
+    ctx.setBackDist(to, 0);
+    auto &fwdList = ctx.getOpenList();
+    auto &backList = ctx.getBackOpenList();
+    fwdList.clear();
+    backList.clear();
+    fwdList.push_back(from);
+    backList.push_back(to);
+
+    // The best connection found, an edge from a forward cell
+    // to a backward cell
+    Point::value_type best = INF;
+    index_type meetFwd = Point::NO_INDEX, meetBack = Point::NO_INDEX;
+
+    // Start searching
+    size_type fwdHead = 0, backHead = 0, expandCnt = 0;
+    while (best == INF && fwdHead < fwdList.size() && backHead < backList.size()) {
+        bool forward = fwdList.size() - fwdHead <= backList.size() - backHead;
+        auto &openList = forward ? fwdList : backList;
+        auto &head = forward ? fwdHead : backHead;
+
+        // Expand a whole layer of one side
+        for (size_type end = openList.size(); head < end; ++head) {
+            auto cur = openList[head];
+            ctx.showVisitPosIfNeed(cur);
+            ++expandCnt;
+
+            // Arrange the order of traversing to make the result path as straight as possible.
+            // The backward side prefers the cell the path comes straight from.
+            Direc bestDirec;
+            if (forward) {
+                bestDirec = (cur == from ? initDirec : getDirection(ctx.getParent(cur), cur));
+            } else {
+                bestDirec = (cur == to ? NONE : getDirection(ctx.getBackParent(cur), cur));
+            }
+            Direc direcs[4] = {LEFT, UP, RIGHT, DOWN};
+            if (bestDirec != NONE) {
+                std::swap(direcs[0], direcs[bestDirec - 1]);
+            }
+
+            // Traverse adjacent cells
+            for (const auto &d : direcs) {
+                auto adj = cur + adjOffset[d];
+                auto fwdCell = forward ? cur : adj, backCell = forward ? adj : cur;
+                if (fwdCell == from && backCell == to && ctx.isVisit(from) == true) {
                     continue; // Don't allow super-short solutions
                 }
 
-                adjPoint.setParent(curPos);
-                adjPoint.setDist(curPoint.getDist() + 1);
-                openList.push(adjPos);
+                // Check if the other side is met
+                auto other = forward ? ctx.getBackDist(adj) : ctx.getDist(adj);
+                if (other != INF) {
+                    auto len = ctx.getDist(fwdCell) + 1 + ctx.getBackDist(backCell);
+                    if (len < best) {
+                        best = len;
+                        meetFwd = fwdCell;
+                        meetBack = backCell;
+                    }
+                    continue;
+                }
+
+                if (isEmpty(adj) && ctx.isVisit(adj) == false) {
+                    if (forward && ctx.getDist(adj) == INF) {
+                        ctx.setParent(adj, cur);
+                        ctx.setDist(adj, ctx.getDist(cur) + 1);
+                        openList.push_back(adj);
+                    } else if (!forward && ctx.getBackDist(adj) == INF) {
+                        ctx.setBackParent(adj, cur);
+                        ctx.setBackDist(adj, ctx.getBackDist(cur) + 1);
+                        openList.push_back(adj);
+                    }
+                }
             }
         }
     }
+    ctx.setExpandCount(expandCnt);
+    if (best == INF) {
+        return;
+    }
+
+    // Join the forward path, the meeting edge and the backward path
+    constructPath(from, meetFwd, ctx, path);
+    path.push_back(getDirection(meetFwd, meetBack));
+    for (auto cur = meetBack; cur != to; cur = ctx.getBackParent(cur)) {
+        path.push_back(getDirection(cur, ctx.getBackParent(cur)));
+    }
+    showPathIfNeed(ctx, from, path);
 }
 
-void Map::markPathVisited(const Pos& from, const list<Direc>& path) {
-    Pos p = from;
-    getPoint(p).setVisit(true);
+void Map::findDetour(const index_type &first, const index_type &second, const Direc &d,
+                     SearchContext &ctx, Path &detour) const {
+    detour.clear();
+
+    // Two cells beside the step make the shortest detour. They are
+    // tried in the order the breadth-first search would find them.
+    Direc sides[4] = {LEFT, UP, RIGHT, DOWN};
+    std::swap(sides[0], sides[d - 1]);
+    for (const auto &side : sides) {
+        auto a = first + adjOffset[side], b = second + adjOffset[side];
+        if (a == second || b == first) {
+            continue;  // Along the step itself
+        }
+        if (isEmpty(a) && isEmpty(b)
+                && ctx.isVisit(a) == false && ctx.isVisit(b) == false) {
+            detour.push_back(side);
+            detour.push_back(d);
+            detour.push_back(getDirection(b, second));
+            return;
+        }
+    }
+
+    // A longer detour must leave the first cell and enter the second
+    // one through free cells
+    if (hasFreeAdj(first, second, ctx) && hasFreeAdj(second, first, ctx)) {
+        searchMinPath(first, second, d, ctx, detour);
+    }
+}
+
+bool Map::hasFreeAdj(const index_type &i, const index_type &except,
+                     const SearchContext &ctx) const {
+    for (int d = LEFT; d <= DOWN; ++d) {
+        auto adj = i + adjOffset[d];
+        if (adj != except && isEmpty(adj) && ctx.isVisit(adj) == false) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Map::markPathVisited(const index_type &from, const Path &path, SearchContext &ctx) const {
+    auto i = from;
+    ctx.setVisit(i, true);
 
     for (const Direc &d : path) {
-        p = p.getAdjPos(d);
-        getPoint(p).setVisit(true);
+        i += adjOffset[d];
+        ctx.setVisit(i, true);
     }
 }
 
-void Map::findMaxPath(const Pos &from, const Pos &to, const Direc &initDirec, list<Direc> &path) {
+void Map::findMaxPath(const index_type &from, const index_type &to, const Direc &initDirec,
+                      SearchContext &ctx, Path &path) const {
+    path.clear();
     if (!isInside(from) || !isInside(to)) {
         return;
     }
-    initMax();
-    path.clear();
+    ctx.resize(rowCnt, colCnt);
+    ctx.initMax();
 
-    findMinPath(from, to, initDirec, path); // Find a path first
+    findMinPath(from, to, initDirec, ctx, path); // Find a path first
     if (path.empty()) {
         return;
     }
-    showPathIfNeed(from, path);
+    showPathIfNeed(ctx, from, path);
+
+    // Mark all points in path as visited, so they're not found below.
+    // Points are never removed from the path, so the marks are only
+    // extended when a detour is spliced in.
+    markPathVisited(from, path, ctx);
 
     // Try to find alternate paths between each pair of points
-    // until we can't find any more
-    size_t size;
+    // until we can't find any more. Every pass copies the path once
+    // with the detours spliced in, instead of shifting the steps
+    // behind each detour.
+    Path extended, detour;
+    extended.reserve(content.size());
+    bool grown;
     do {
-        size = path.size();
+        grown = false;
+        extended.clear();
 
         // Search for a different path between each pair
-        Pos first = from;
-        for (auto i=path.begin(); i!=path.end();) {
-
-            // Mark all points in path as visited, so they're not found below
-            markPathVisited(from, path);
-
-            Pos second = first.getAdjPos(*i);
-            getPoint(second).setVisit(false);
-
-            list<Direc> subpath;
-            findMinPath(first, second, *i, subpath);
-            size_t subsize = subpath.size();
-
-            if (subpath.size() > 1) {
-                showPathIfNeed(first, subpath);
-                if (i == path.begin()) {
-                    // You can't -- begin or things break
-                    path.splice(i, subpath);
-                    path.erase(i);
-                    i = path.begin();
-
-                } else {
-                    auto j = i;
-                    j--;
-                    path.splice(i, subpath);
-                    path.erase(i);
-                    i = j;
-                    i++;
-                }
-                for (size_t z = 0; z < subsize; z++) {
-                    i++;
-                }
+        auto first = from;
+        for (const auto &d : path) {
+            auto second = first + adjOffset[d];
+            ctx.setVisit(second, false);
 
+            findDetour(first, second, d, ctx, detour);
+
+            if (detour.size() > 1) {
+                showPathIfNeed(ctx, first, detour);
+                markPathVisited(first, detour, ctx);
+                for (const auto &step : detour) {
+                    extended.push_back(step);
+                }
+                grown = true;
             } else {
-                i++;
+                ctx.setVisit(second, true);
+                extended.push_back(d);
             }
             first = second;
         }
 
-        showPathIfNeed(from, path);
-    } while (path.size() > size);
+        path.swap(extended);
+        showPathIfNeed(ctx, from, path);
+    } while (grown);
 
-    initMax();
+    ctx.initMax();
 }
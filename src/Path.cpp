@@ -0,0 +1,157 @@
+#include "Path.h"
+#include <algorithm>
+
+const Path::size_type Path::STEP_BITS;
+const Path::size_type Path::WORD_STEPS;
+
+Path::const_iterator::const_iterator(const Path *path_, const size_type &i_)
+    : path(path_), i(i_) {
+}
+
+Direc Path::const_iterator::operator*() const {
+    return path->get(i);
+}
+
+Path::const_iterator& Path::const_iterator::operator++() {
+    ++i;
+    return *this;
+}
+
+Path::const_iterator Path::const_iterator::operator++(int) {
+    const_iterator tmp = *this;
+    ++i;
+    return tmp;
+}
+
+bool operator==(const Path::const_iterator &a, const Path::const_iterator &b) {
+    return a.i == b.i;
+}
+
+bool operator!=(const Path::const_iterator &a, const Path::const_iterator &b) {
+    return a.i != b.i;
+}
+
+Path::Path() {
+}
+
+Path::~Path() {
+}
+
+Path::size_type Path::capacity() const {
+    return buf.size() * WORD_STEPS;
+}
+
+Direc Path::get(const size_type &k) const {
+    auto code = (buf[k / WORD_STEPS] >> (k % WORD_STEPS * STEP_BITS)) & 3;
+    return static_cast<Direc>(code + 1);
+}
+
+void Path::set(const size_type &k, const Direc &d) {
+    auto shift = k % WORD_STEPS * STEP_BITS;
+    word_type &w = buf[k / WORD_STEPS];
+    w = (w & ~(static_cast<word_type>(3) << shift))
+        | (static_cast<word_type>(d - 1) << shift);
+}
+
+void Path::move(const size_type &from, const size_type &to, const size_type &n) {
+    if (to < from) {
+        for (size_type k = 0; k < n; ++k) {
+            set(to + k, get(from + k));
+        }
+    } else if (to > from) {
+        for (size_type k = n; k-- > 0;) {
+            set(to + k, get(from + k));
+        }
+    }
+}
+
+void Path::recenter(const size_type &space) {
+    auto n = size();
+    if (capacity() < n + 2 * space) {
+        auto words = (n + 2 * space + WORD_STEPS - 1) / WORD_STEPS;
+        std::vector<word_type> tmp(std::max(words, 2 * buf.size()), 0);
+        buf.swap(tmp);
+        auto newFirst = (capacity() - n) / 2;
+        for (size_type k = 0; k < n; ++k) {
+            auto shift = (first + k) % WORD_STEPS * STEP_BITS;
+            auto code = (tmp[(first + k) / WORD_STEPS] >> shift) & 3;
+            set(newFirst + k, static_cast<Direc>(code + 1));
+        }
+        first = newFirst;
+    } else {
+        auto newFirst = (capacity() - n) / 2;
+        move(first, newFirst, n);
+        first = newFirst;
+    }
+    last = first + n;
+}
+
+void Path::reserve(const size_type &n) {
+    if (first < n || capacity() - last < n) {
+        recenter(n);
+    }
+}
+
+void Path::swap(Path &other) {
+    buf.swap(other.buf);
+    std::swap(first, other.first);
+    std::swap(last, other.last);
+}
+
+void Path::clear() {
+    first = last = capacity() / 2;
+}
+
+bool Path::empty() const {
+    return first == last;
+}
+
+Path::size_type Path::size() const {
+    return last - first;
+}
+
+Direc Path::front() const {
+    return get(first);
+}
+
+Direc Path::operator[](const size_type &i) const {
+    return get(first + i);
+}
+
+void Path::push_front(const Direc &d) {
+    if (first == 0) {
+        recenter(std::max(size(), WORD_STEPS));
+    }
+    set(--first, d);
+}
+
+void Path::push_back(const Direc &d) {
+    if (last == capacity()) {
+        recenter(std::max(size(), WORD_STEPS));
+    }
+    set(last++, d);
+}
+
+Path::const_iterator Path::begin() const {
+    return const_iterator(this, first);
+}
+
+Path::const_iterator Path::end() const {
+    return const_iterator(this, last);
+}
+
+bool operator==(const Path &a, const Path &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (Path::size_type k = 0; k < a.size(); ++k) {
+        if (a[k] != b[k]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool operator!=(const Path &a, const Path &b) {
+    return !(a == b);
+}
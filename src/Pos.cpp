@@ -37,8 +37,8 @@ bool operator!=(const Pos &a, const Pos &b) {
     return !(a == b);
 }
 
-std::vector<Pos> Pos::getAllAdjPos() const {
-    std::vector<Pos> res(4);
+std::array<Pos, 4> Pos::getAllAdjPos() const {
+    std::array<Pos, 4> res;
     int dx[] = {0, -1, 0, 1};
     int dy[] = {-1, 0, 1, 0};
     for (int i = 0; i < 4; ++i) {
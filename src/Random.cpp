@@ -0,0 +1,55 @@
+#include "Random.h"
+#include <atomic>
+#include <chrono>
+
+static inline uint64_t rotl(const uint64_t x, const int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t splitMix(uint64_t &x) {
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+Random::Random(const seed_type s) {
+    seed(s);
+}
+
+void Random::seed(const seed_type s) {
+    // Spread the seed over the state, which must not be all zero
+    uint64_t x = s;
+    for (auto &word : state) {
+        word = splitMix(x);
+    }
+}
+
+Random::result_type Random::next() {
+    const uint64_t result = rotl(state[1] * 5, 7) * 9;
+    const uint64_t t = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = rotl(state[3], 45);
+    return result;
+}
+
+Random::result_type Random::below(const result_type n) {
+    // Reject the top values that would make the low ones likelier
+    const result_type limit = UINT64_MAX - UINT64_MAX % n;
+    result_type r;
+    do {
+        r = next();
+    } while (r >= limit);
+    return r % n;
+}
+
+Random::seed_type Random::timeSeed() {
+    static std::atomic<uint64_t> counter(0);
+    uint64_t x = static_cast<uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count())
+                 + (counter++ << 32);
+    return splitMix(x);
+}
@@ -0,0 +1,197 @@
+#include "SearchContext.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+const long SearchContext::detailInterval;
+
+SearchContext::SearchContext() {
+}
+
+SearchContext::~SearchContext() {
+}
+
+void SearchContext::resize(const size_type &rowCnt_, const size_type &colCnt_) {
+    if (rowCnt == rowCnt_ && colCnt == colCnt_) {
+        return;
+    }
+    rowCnt = rowCnt_;
+    colCnt = colCnt_;
+    auto n = rowCnt * colCnt;
+    dist.assign(n, INF);
+    parent.assign(n, Point::NO_INDEX);
+    distStamp.assign(n, 0);
+    visitStamp.assign(n, 0);
+    backDist.assign(n, INF);
+    backParent.assign(n, Point::NO_INDEX);
+    backDistStamp.assign(n, 0);
+    freeTime.assign(n, INF);
+    freeTimeStamp.assign(n, 0);
+    reach.resize(rowCnt, colCnt);
+    openList.reserve(n);
+    backOpenList.reserve(n);
+    // f never exceeds the amount of cells plus the longest Manhatten
+    // distance, and it grows by 2 per bucket
+    bucketTop.assign((n + rowCnt + colCnt) / 2 + 1, Point::NO_INDEX);
+    entryCell.reserve(4 * n);
+    entryNext.reserve(4 * n);
+    maxBucket = 0;
+    distGen = visitGen = backDistGen = freeTimeGen = 1;
+    if (showSearchDetails) {
+        detail.assign(n, Point::Type::EMPTY);
+    }
+}
+
+void SearchContext::nextGen(stamp_type &gen, std::vector<stamp_type> &stamps) {
+    if (++gen == 0) {
+        std::fill(stamps.begin(), stamps.end(), 0);
+        gen = 1;
+    }
+}
+
+void SearchContext::initMin() {
+    nextGen(distGen, distStamp);
+    nextGen(backDistGen, backDistStamp);
+}
+
+void SearchContext::initMax() {
+    nextGen(visitGen, visitStamp);
+}
+
+void SearchContext::initFreeTime() {
+    nextGen(freeTimeGen, freeTimeStamp);
+}
+
+Point::value_type SearchContext::getDist(const Point::index_type &i) const {
+    return distStamp[i] == distGen ? dist[i] : INF;
+}
+
+void SearchContext::setDist(const Point::index_type &i, const Point::value_type dist_) {
+    dist[i] = dist_;
+    distStamp[i] = distGen;
+}
+
+Point::index_type SearchContext::getParent(const Point::index_type &i) const {
+    return parent[i];
+}
+
+void SearchContext::setParent(const Point::index_type &i, const Point::index_type &parent_) {
+    parent[i] = parent_;
+}
+
+bool SearchContext::isVisit(const Point::index_type &i) const {
+    return visitStamp[i] == visitGen;
+}
+
+void SearchContext::setVisit(const Point::index_type &i, const bool v) {
+    visitStamp[i] = v ? visitGen : 0;
+}
+
+Point::value_type SearchContext::getBackDist(const Point::index_type &i) const {
+    return backDistStamp[i] == backDistGen ? backDist[i] : INF;
+}
+
+void SearchContext::setBackDist(const Point::index_type &i, const Point::value_type dist_) {
+    backDist[i] = dist_;
+    backDistStamp[i] = backDistGen;
+}
+
+Point::index_type SearchContext::getBackParent(const Point::index_type &i) const {
+    return backParent[i];
+}
+
+void SearchContext::setBackParent(const Point::index_type &i, const Point::index_type &parent_) {
+    backParent[i] = parent_;
+}
+
+Point::value_type SearchContext::getFreeTime(const Point::index_type &i) const {
+    return freeTimeStamp[i] == freeTimeGen ? freeTime[i] : INF;
+}
+
+void SearchContext::setFreeTime(const Point::index_type &i, const Point::value_type t) {
+    freeTime[i] = t;
+    freeTimeStamp[i] = freeTimeGen;
+}
+
+Bitboard& SearchContext::getReach() {
+    return reach;
+}
+
+std::vector<Point::index_type>& SearchContext::getOpenList() {
+    return openList;
+}
+
+std::vector<Point::index_type>& SearchContext::getBackOpenList() {
+    return backOpenList;
+}
+
+void SearchContext::clearBuckets() {
+    for (size_type b = 0; b <= maxBucket && b < bucketTop.size(); ++b) {
+        bucketTop[b] = Point::NO_INDEX;
+    }
+    entryCell.clear();
+    entryNext.clear();
+    maxBucket = 0;
+}
+
+void SearchContext::pushBucket(const size_type &b, const Point::index_type &i) {
+    entryNext.push_back(bucketTop[b]);
+    entryCell.push_back(i);
+    bucketTop[b] = static_cast<Point::index_type>(entryCell.size() - 1);
+    maxBucket = std::max(maxBucket, b);
+}
+
+bool SearchContext::popBucket(const size_type &b, Point::index_type &i) {
+    auto e = bucketTop[b];
+    if (e == Point::NO_INDEX) {
+        return false;
+    }
+    i = entryCell[e];
+    bucketTop[b] = entryNext[e];
+    return true;
+}
+
+SearchContext::size_type SearchContext::getBucketCount() const {
+    return bucketTop.size();
+}
+
+SearchContext::size_type SearchContext::getExpandCount() const {
+    return expandCnt;
+}
+
+void SearchContext::setExpandCount(const size_type &n) {
+    expandCnt = n;
+}
+
+void SearchContext::setShowSearchDetails(const bool &b) {
+    showSearchDetails = b;
+    if (showSearchDetails) {
+        detail.assign(rowCnt * colCnt, Point::Type::EMPTY);
+    } else {
+        detail.clear();
+    }
+}
+
+bool SearchContext::isShowSearchDetails() const {
+    return showSearchDetails;
+}
+
+Point::Type SearchContext::getDetail(const Point::index_type &i) const {
+    if (!showSearchDetails || detail.empty()) {
+        return Point::Type::EMPTY;
+    }
+    return static_cast<Point::Type>(detail[i]);
+}
+
+void SearchContext::showPosSearchDetail(const Point::index_type &i, const Point::Type &t) {
+    detail[i] = static_cast<unsigned char>(t);
+    std::this_thread::sleep_for(std::chrono::milliseconds(detailInterval));
+}
+
+void SearchContext::showVisitPosIfNeed(const Point::index_type &i) {
+    if (showSearchDetails) {
+        if (getDetail(i) != Point::Type::TEST_PATH) {
+            showPosSearchDetail(i, Point::Type::TEST_VISIT);
+        }
+    }
+}
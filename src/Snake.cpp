@@ -1,10 +1,6 @@
 #include "Snake.h"
-#include "GameCtrl.h"
-
-#include <algorithm>
 
 using std::vector;
-using std::list;
 using std::shared_ptr;
 
 Snake::Snake() {
@@ -18,17 +14,21 @@ bool Snake::isDead() const {
 }
 
 bool Snake::addBody(const Pos &p) {
-    if (map && map->isInside(p)) {
+    return map && addBody(map->toIndex(p));
+}
+
+bool Snake::addBody(const index_type &i) {
+    if (map && map->isInside(i)) {
         if (body.size() == 0) {  // Insert a head
-            map->getPoint(p).setType(headType);
+            map->setType(i, headType);
         } else {  // Insert a body
             if (body.size() > 1) {
                 auto oldTail = getTail();
-                map->getPoint(oldTail).setType(bodyType);
+                map->setType(oldTail, bodyType);
             }
-            map->getPoint(p).setType(tailType);
+            map->setType(i, tailType);
         }
-        body.push_back(p);
+        body.push_back(i);
         return true;
     } else {
         return false;
@@ -51,44 +51,85 @@ void Snake::setTailType(const Point::Type &type) {
     tailType = type;
 }
 
+void Snake::setSearchAlgo(const Map::SearchAlgo &algo) {
+    searchAlgo = algo;
+}
+
+void Snake::setCycleCacheDir(const std::string &dir) {
+    cycleCacheDir = dir;
+}
+
+void Snake::setCycleThreadCount(const unsigned &n) {
+    hamilton.setThreadCount(n);
+}
+
+void Snake::setRerouteCycle(const bool &b) {
+    rerouteCycle = b;
+}
+
 Direc Snake::getDirection() const {
     return direc;
 }
 
-void Snake::setMap(std::shared_ptr<Map> m) {
+void Snake::setMap(std::shared_ptr<Map> m, Random &rng) {
     map = m;
 
-    std::vector<Pos> emptySpaces;
-    map->getEmptyPoints(emptySpaces);
-    safeLength = emptySpaces.size() * 3 / 4;
+    safeLength = map->getEmptyCount() * 3 / 4;
+    pathToFood.reserve(map->getRowCount() * map->getColCount());
+    search.resize(map->getRowCount(), map->getColCount());
+
+    // One more than the playable area for the head moved in last
+    body.reset((map->getRowCount() - 2) * (map->getColCount() - 2) + 1);
+
+    std::string cacheFile;
+    if (!cycleCacheDir.empty()) {
+        cacheFile = cycleCacheDir + "/" + Hamilton::cacheName(*map);
+        if (hamilton.load(*map, cacheFile)) {
+            return;
+        }
+    }
 
+    // Retrying is only worth it if a covering cycle can exist
+    hamilton.checkFeasible(*map);
     for (int i=0; ; i++) {
         try {
-            hamilton.generate(*map);
-            return;
+            hamilton.generate(*map, search, rng);
+            break;
         } catch (std::exception& e) {
             if (i >= 10) {
                 throw;
             }
         }
     }
+
+    // A cache that can't be written only costs the next start its speed
+    if (!cacheFile.empty()) {
+        hamilton.save(*map, cacheFile);
+    }
 }
 
-void Snake::createBody() {
-    Pos p = map->randomEmpty();;
+void Snake::createBody(Random &rng) {
+    index_type p = map->randomEmpty(rng);
     for (int i=0; i<3; i++) {
         addBody(p);
         p = hamilton.next(p);
     }
-    std::reverse(body.begin(), body.end());
+    // The body was added tail first, so the end types swap as well
+    body.reverse();
+    map->setType(getHead(), headType);
+    map->setType(getTail(), tailType);
+}
+
+Snake::index_type Snake::getHead() const {
+    return body.front();
 }
 
-const Pos& Snake::getHead() const {
-    return *body.begin();
+Snake::index_type Snake::getTail() const {
+    return body.back();
 }
 
-const Pos& Snake::getTail() const {
-    return *body.rbegin();
+const RingBuffer<Snake::index_type>& Snake::getBody() const {
+    return body;
 }
 
 Snake::size_type Snake::length() const {
@@ -97,11 +138,11 @@ Snake::size_type Snake::length() const {
 
 void Snake::removeTail() {
     if (map) {
-        map->getPoint(getTail()).setType(Point::Type::EMPTY);
+        map->setType(getTail(), Point::Type::EMPTY);
     }
     body.pop_back();
     if (body.size() > 1) {
-        map->getPoint(getTail()).setType(tailType);
+        map->setType(getTail(), tailType);
     }
 }
 
@@ -110,83 +151,115 @@ void Snake::move() {
         return;
     }
 
-    map->getPoint(getHead()).setType(bodyType);
-    Pos newHead = getHead().getAdjPos(direc);
+    map->setType(getHead(), bodyType);
+    index_type newHead = map->getAdj(getHead(), direc);
     body.push_front(newHead);
 
     if (!map->isSafe(newHead)) {
         dead = true;
     } else {
-        if (map->getPoint(newHead).getType() != Point::Type::FOOD) {
+        if (map->getType(newHead) != Point::Type::FOOD) {
             removeTail();
         } else {
             map->removeFood();
         }
     }
 
-    map->getPoint(newHead).setType(headType);
+    map->setType(newHead, headType);
 }
 
-void Snake::move(const std::list<Direc> &path) {
+void Snake::move(const Path &path) {
     for (const auto &d : path) {
         setDirection(d);
         move();
     }
 }
 
-void Snake::findPathTo(const int type, const Pos &to, std::list<Direc> &path) {
-    if (to == Pos::INVALID) {
+void Snake::findPathTo(const int type, const index_type &to, Path &path) {
+    path.clear();
+    if (to == Point::NO_INDEX) {
         return;
     }
-    // To search the path to goal, first set the goal grid type to EMPTY
-    // and then start searching because the original type of the goal
-    // grid may be a FOOD or another type which is ignored by the search algorithm.
-    // After searching, restore the goal grid type.
-    auto originType = map->getPoint(to).getType();
-    map->getPoint(to).setType(Point::Type::EMPTY);
+    // The searches enter the goal whatever its type, so the map is
+    // left as it is
     if (type == 0) {
-        map->findMinPath(getHead(), to, direc, path);
+        if (searchAlgo == Map::TIMED) {
+            updateFreeTime();
+        }
+        map->findMinPath(getHead(), to, direc, search, path, searchAlgo);
     } else if (type == 1) {
-        map->findMaxPath(getHead(), to, direc, path);
+        map->findMaxPath(getHead(), to, direc, search, path);
     }
-    map->getPoint(to).setType(originType);
 }
 
-void Snake::findMinPathToFood(std::list<Direc> &path) {
+void Snake::findMinPathToFood(Path &path) {
     findPathTo(0, map->getFood(), path);
 }
 
-void Snake::findMinPathToTail(std::list<Direc> &path) {
+void Snake::findMinPathToTail(Path &path) {
     findPathTo(0, getTail(), path);
 }
 
-void Snake::findMaxPathToTail(std::list<Direc> &path) {
+void Snake::findMaxPathToTail(Path &path) {
     findPathTo(1, getTail(), path);
 }
 
+void Snake::updateFreeTime() {
+    search.resize(map->getRowCount(), map->getColCount());
+    search.initFreeTime();
+    auto len = body.size();
+    for (size_type k = 1; k < len; ++k) {
+        search.setFreeTime(body[k], len - k + 1);
+    }
+}
+
+bool Snake::keepsFreeRegion(const index_type &next) {
+    auto emptyCnt = map->getEmptyCount();
+    if (map->getType(next) == Point::Type::EMPTY) {
+        --emptyCnt;
+    }
+    return map->countFreeRegion(next, search) >= emptyCnt;
+}
+
 void Snake::decideNext() {
     if (isDead() || !map) {
         return;
     }
 
-    Pos nextH = hamilton.next(getHead());
-    Direc dirH = getHead().getDirectionTo(nextH);
+    if (rerouteCycle && map->hasFood()) {
+        hamilton.reroute(getHead(), getTail(), map->getFood());
+    }
+
+    index_type nextH = hamilton.next(getHead());
+    Direc dirH = map->getDirection(getHead(), nextH);
 
-    // Step1: Find shortest path, follow if not before tail..head
-    list<Direc> pathToFood;
-    findMinPathToFood(pathToFood);
-    if (!pathToFood.empty()) {
-        Direc dirF = *(pathToFood.begin());
-        Pos nextF = getHead().getAdjPos(dirF);
+    // Step1: Find shortest path, follow if not before tail..head.
+    // Only the first step is needed, which the distance field to the
+    // food gives directly if the map keeps it. The time-aware search
+    // may find shorter paths, so it always searches.
+    Direc dirF = NONE;
+    if (map->isUseFoodDist() && searchAlgo != Map::TIMED) {
+        dirF = map->getFoodDirec(getHead(), direc);
+    } else {
+        findMinPathToFood(pathToFood);
+        if (!pathToFood.empty()) {
+            dirF = *(pathToFood.begin());
+        }
+    }
+    if (dirF != NONE) {
+        index_type nextF = map->getAdj(getHead(), dirF);
         auto headLoc = hamilton.location(getTail(), getHead());
         auto nextLoc = hamilton.location(getTail(), nextF);
         auto foodLoc = hamilton.location(getTail(), map->getFood());
-        auto nextToTail = hamilton.location(nextF, getTail());
+        // Places are counted from the anchor's own sequence number, so
+        // the steps left from the next cell to the tail are a difference
+        auto nextToTail = hamilton.location(nextF, getTail()) - hamilton.location(nextF, nextF);
 
         if (headLoc < nextLoc
                 && nextLoc <= foodLoc
                 && nextToTail > 10
-                && length() < safeLength) {
+                && length() < safeLength
+                && keepsFreeRegion(nextF)) {
             this->setDirection(dirF);
             return;
         }
@@ -0,0 +1,76 @@
+#include "TaskPool.h"
+#include <exception>
+#include <thread>
+
+TaskPool::TaskPool(const unsigned threadCnt_) : threadCnt(threadCnt_) {
+    if (threadCnt == 0) {
+        threadCnt = std::thread::hardware_concurrency();
+    }
+    if (threadCnt == 0) {
+        threadCnt = 1;
+    }
+}
+
+unsigned TaskPool::getThreadCount() const {
+    return threadCnt;
+}
+
+void TaskPool::run(const task_type taskCnt, const std::function<void(task_type)> &task) {
+    // Hand out consecutive ranges so neighbouring tasks share a worker
+    std::vector<Queue> queues(threadCnt);
+    for (unsigned w = 0; w < threadCnt; ++w) {
+        for (task_type t = taskCnt * w / threadCnt; t < taskCnt * (w + 1) / threadCnt; ++t) {
+            queues[w].tasks.push_back(t);
+        }
+    }
+
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    auto work = [&](const unsigned self) {
+        task_type t;
+        while (take(queues, self, t)) {
+            try {
+                task(t);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned w = 1; w < threadCnt; ++w) {
+        workers.emplace_back(work, w);
+    }
+    work(0);
+    for (auto &w : workers) {
+        w.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+bool TaskPool::take(std::vector<Queue> &queues, const unsigned self, task_type &task) {
+    {
+        std::lock_guard<std::mutex> lock(queues[self].mutex);
+        if (!queues[self].tasks.empty()) {
+            task = queues[self].tasks.back();
+            queues[self].tasks.pop_back();
+            return true;
+        }
+    }
+    // No task adds others, so once every queue is seen empty the work is done
+    for (size_t i = 1; i < queues.size(); ++i) {
+        Queue &victim = queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,207 @@
+#include "GameSession.h"
+#include "TaskPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+/*
+Run many headless games in parallel and print statistics of the results.
+
+Usage: snake_batch [-n games] [-r rows] [-c cols] [-t threads] [-m maxMoves] [-s seed] [-w]
+
+Game i is seeded with seed + i, so "-s <seed + i> -n 1" replays it alone.
+*/
+
+enum Outcome {
+    WIN,
+    LOSE,
+    TIMEOUT,
+    ERROR     // The game couldn't start, e.g. no hamilton cycle was found
+};
+
+struct BatchConfig {
+    long games = 100;
+    Map::size_type rows = 20;
+    Map::size_type cols = 20;
+    unsigned threads = 0;     // One a core
+    long long maxMoves = 0;   // The square of the playable area
+    Random::seed_type seed = Random::timeSeed();
+    bool hardMode = false;
+};
+
+struct GameResult {
+    Random::seed_type seed = 0;
+    Outcome outcome = LOSE;
+    long long moves = 0;
+    long foods = 0;
+    double decideTotal = 0;  // Seconds spent in decideNext()
+    double decideMax = 0;
+    std::string error;  // Message of an ERROR
+};
+
+static void playSession(const BatchConfig &config, GameResult &result) {
+    GameSession session;
+    session.setMapRow(config.rows);
+    session.setMapCol(config.cols);
+    session.setHardMode(config.hardMode);
+    session.setSeed(result.seed);
+    session.setCycleThreadCount(1);  // The pool already keeps every core busy
+    session.init();
+    auto startLength = session.getSnake().length();
+
+    long long maxMoves = config.maxMoves;
+    if (maxMoves == 0) {
+        long long area = static_cast<long long>(config.rows - 2) * (config.cols - 2);
+        maxMoves = area * area;
+    }
+
+    while (!session.isOver() && session.getMoveCount() < maxMoves) {
+        session.tick();
+        double elapsed = std::chrono::duration<double>(session.getThinkingTime()).count();
+        result.decideTotal += elapsed;
+        result.decideMax = std::max(result.decideMax, elapsed);
+    }
+
+    result.moves = session.getMoveCount();
+    result.foods = static_cast<long>(session.getSnake().length() - startLength);
+    if (session.isWin()) {
+        result.outcome = WIN;
+    } else if (session.isDead()) {
+        result.outcome = LOSE;
+    } else {
+        result.outcome = TIMEOUT;
+    }
+}
+
+/*
+Play one game, recording an ERROR instead of throwing if it can't start,
+so that the other games of the batch still count.
+*/
+static void playGame(const BatchConfig &config, GameResult &result) {
+    try {
+        playSession(config, result);
+    } catch (const std::exception &e) {
+        auto seed = result.seed;
+        result = GameResult();
+        result.seed = seed;
+        result.outcome = ERROR;
+        result.error = e.what();
+    }
+}
+
+static void printUsage() {
+    fprintf(stderr, "Usage: snake_batch [-n games] [-r rows] [-c cols] [-t threads] [-m maxMoves] [-s seed] [-w]\n"
+                    "  -n  number of games, default 100\n"
+                    "  -r  map rows including the boundaries, default 20\n"
+                    "  -c  map columns including the boundaries, default 20\n"
+                    "  -t  worker threads, default one a core\n"
+                    "  -m  moves before a game times out, default the square of the playable area\n"
+                    "  -s  seed of the first game, the others count up from it, default from the clock\n"
+                    "  -w  add the walls of the hard mode, which needs a 20*20 map\n");
+}
+
+static bool parseArgs(int argc, char **argv, BatchConfig &config) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-w") == 0) {
+            config.hardMode = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        long long value = atoll(argv[i + 1]);
+        if (strcmp(argv[i], "-n") == 0) {
+            config.games = static_cast<long>(value);
+        } else if (strcmp(argv[i], "-r") == 0) {
+            config.rows = static_cast<Map::size_type>(value);
+        } else if (strcmp(argv[i], "-c") == 0) {
+            config.cols = static_cast<Map::size_type>(value);
+        } else if (strcmp(argv[i], "-t") == 0) {
+            config.threads = static_cast<unsigned>(value);
+        } else if (strcmp(argv[i], "-m") == 0) {
+            config.maxMoves = value;
+        } else if (strcmp(argv[i], "-s") == 0) {
+            config.seed = strtoull(argv[i + 1], nullptr, 10);
+        } else {
+            return false;
+        }
+        ++i;
+    }
+    return config.games > 0 && config.rows >= 4 && config.cols >= 4 && config.maxMoves >= 0
+           && (!config.hardMode || (config.rows == 20 && config.cols == 20));
+}
+
+int main(int argc, char **argv) {
+    BatchConfig config;
+    if (!parseArgs(argc, argv, config)) {
+        printUsage();
+        return 2;
+    }
+
+    TaskPool pool(config.threads);
+    std::vector<GameResult> results(config.games);
+    for (size_t i = 0; i < results.size(); ++i) {
+        results[i].seed = config.seed + i;
+    }
+    auto start = std::chrono::steady_clock::now();
+    try {
+        pool.run(results.size(), [&](TaskPool::task_type t) {
+            playGame(config, results[t]);
+        });
+    } catch (const std::exception &e) {
+        fprintf(stderr, "Exception: %s\n", e.what());
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long outcomes[4] = {0, 0, 0, 0};
+    long long totalMoves = 0, totalFoods = 0;
+    double decideTotal = 0, decideMax = 0;
+    std::vector<long long> moves;
+    moves.reserve(results.size());
+    for (const auto &r : results) {
+        outcomes[r.outcome]++;
+        if (r.outcome == ERROR) {
+            continue;
+        }
+        totalMoves += r.moves;
+        totalFoods += r.foods;
+        decideTotal += r.decideTotal;
+        decideMax = std::max(decideMax, r.decideMax);
+        moves.push_back(r.moves);
+    }
+    std::sort(moves.begin(), moves.end());
+
+    printf("Map: %lu*%lu%s, games: %ld, threads: %u, seed: %llu\n",
+           static_cast<unsigned long>(config.rows), static_cast<unsigned long>(config.cols),
+           config.hardMode ? " hard" : "", config.games, pool.getThreadCount(),
+           static_cast<unsigned long long>(config.seed));
+    printf("Win: %ld  Lose: %ld  Timeout: %ld  Error: %ld\n",
+           outcomes[WIN], outcomes[LOSE], outcomes[TIMEOUT], outcomes[ERROR]);
+    for (const auto &r : results) {
+        if (r.outcome == ERROR) {
+            printf("  Error with seed %llu: %s\n", static_cast<unsigned long long>(r.seed), r.error.c_str());
+        } else if (r.outcome != WIN) {
+            printf("  %s with seed %llu after %lld moves\n", r.outcome == LOSE ? "Lost" : "Timed out",
+                   static_cast<unsigned long long>(r.seed), r.moves);
+        }
+    }
+    if (moves.empty()) {
+        return 1;
+    }
+    printf("Moves a game: min %lld  median %lld  mean %.1f  max %lld\n",
+           moves.front(), moves[moves.size() / 2],
+           static_cast<double>(totalMoves) / moves.size(), moves.back());
+    printf("Foods a game: %.1f  moves a food: %.1f\n",
+           static_cast<double>(totalFoods) / moves.size(),
+           totalFoods > 0 ? static_cast<double>(totalMoves) / totalFoods : 0.0);
+    printf("Decision: mean %.2fus  max %.2fus\n",
+           totalMoves > 0 ? decideTotal / totalMoves * 1e6 : 0.0, decideMax * 1e6);
+    printf("Time: %.3fs  %.1f games/s  %.0f moves/s\n",
+           seconds, results.size() / seconds, totalMoves / seconds);
+    return outcomes[WIN] == config.games ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+#include "BatchEnv.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+/*
+Drive a BatchEnv the way a learning loop would and print the throughput.
+
+Usage: snake_env [-k games] [-r rows] [-c cols] [-n steps] [-s seed] [-w]
+
+The policy stands in for a model: it reads only the cells, heads and
+foods the env exposes and turns toward the food, among the safe cells.
+*/
+
+struct EnvConfig {
+    BatchEnv::size_type games = 64;
+    Map::size_type rows = 20;
+    Map::size_type cols = 20;
+    long steps = 10000;
+    Random::seed_type seed = Random::timeSeed();
+    bool hardMode = false;
+};
+
+static const Direc allDirecs[4] = {LEFT, UP, RIGHT, DOWN};
+
+static bool isSafeCell(const Map::cell_type c) {
+    return c == Point::Type::EMPTY || c == Point::Type::FOOD;
+}
+
+/*
+Choose the safe direction that gets closest to the food, or keep going
+if none is safe.
+*/
+static Direc greedy(const Map::cell_type *cells, const Map::size_type cols,
+                    const BatchEnv::index_type head, const BatchEnv::index_type food,
+                    const Direc current) {
+    long headRow = head / cols, headCol = head % cols;
+    long foodRow = food / cols, foodCol = food % cols;
+    Direc best = current;
+    long bestDist = -1;
+    for (Direc d : allDirecs) {
+        long row = headRow + (d == DOWN) - (d == UP);
+        long col = headCol + (d == RIGHT) - (d == LEFT);
+        if (!isSafeCell(cells[row * cols + col])) {
+            continue;
+        }
+        long dist = labs(row - foodRow) + labs(col - foodCol);
+        if (bestDist < 0 || dist < bestDist) {
+            best = d;
+            bestDist = dist;
+        }
+    }
+    return best;
+}
+
+static void printUsage() {
+    fprintf(stderr, "Usage: snake_env [-k games] [-r rows] [-c cols] [-n steps] [-s seed] [-w]\n"
+                    "  -k  games stepped together, default 64\n"
+                    "  -r  map rows including the boundaries, default 20\n"
+                    "  -c  map columns including the boundaries, default 20\n"
+                    "  -n  steps of all the games, default 10000\n"
+                    "  -s  seed of the first game, the others count up from it, default from the clock\n"
+                    "  -w  add the walls of the hard mode, which needs a 20*20 map\n");
+}
+
+static bool parseArgs(int argc, char **argv, EnvConfig &config) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-w") == 0) {
+            config.hardMode = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        long long value = atoll(argv[i + 1]);
+        if (strcmp(argv[i], "-k") == 0) {
+            config.games = static_cast<BatchEnv::size_type>(value);
+        } else if (strcmp(argv[i], "-r") == 0) {
+            config.rows = static_cast<Map::size_type>(value);
+        } else if (strcmp(argv[i], "-c") == 0) {
+            config.cols = static_cast<Map::size_type>(value);
+        } else if (strcmp(argv[i], "-n") == 0) {
+            config.steps = static_cast<long>(value);
+        } else if (strcmp(argv[i], "-s") == 0) {
+            config.seed = strtoull(argv[i + 1], nullptr, 10);
+        } else {
+            return false;
+        }
+        ++i;
+    }
+    return config.games > 0 && config.rows >= 4 && config.cols >= 4 && config.steps > 0
+           && (!config.hardMode || (config.rows == 20 && config.cols == 20));
+}
+
+int main(int argc, char **argv) {
+    EnvConfig config;
+    if (!parseArgs(argc, argv, config)) {
+        printUsage();
+        return 2;
+    }
+
+    long episodes = 0, foods = 0, deaths = 0;
+    double rewardSum = 0;
+    double seconds = 0;
+    try {
+        BatchEnv env(config.games, config.rows, config.cols, config.seed, config.hardMode);
+        std::vector<Direc> actions(env.size());
+        auto start = std::chrono::steady_clock::now();
+        for (long s = 0; s < config.steps; ++s) {
+            for (BatchEnv::size_type k = 0; k < env.size(); ++k) {
+                actions[k] = greedy(env.getCells(k), env.getColCount(), env.getHeads()[k],
+                                    env.getFoods()[k], env.getDirections()[k]);
+            }
+            env.step(actions.data());
+            for (BatchEnv::size_type k = 0; k < env.size(); ++k) {
+                auto reward = env.getRewards()[k];
+                rewardSum += reward;
+                foods += reward > 0;
+                deaths += reward < 0;
+                episodes += env.getDones()[k];
+            }
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } catch (const std::exception &e) {
+        fprintf(stderr, "Exception: %s\n", e.what());
+        return 1;
+    }
+
+    double gameSteps = static_cast<double>(config.steps) * config.games;
+    printf("Map: %lu*%lu%s, games: %lu, steps: %ld, seed: %llu\n",
+           static_cast<unsigned long>(config.rows), static_cast<unsigned long>(config.cols),
+           config.hardMode ? " hard" : "", static_cast<unsigned long>(config.games), config.steps,
+           static_cast<unsigned long long>(config.seed));
+    printf("Episodes: %ld  died: %ld  foods: %ld  reward: %.0f\n", episodes, deaths, foods, rewardSum);
+    printf("Time: %.3fs  %.0f game steps/s\n", seconds, seconds > 0 ? gameSteps / seconds : 0.0);
+    return 0;
+}
@@ -13,6 +13,14 @@ int main() {
     // Movements will be written to file "movements.txt".
     game->setRecordMovements(false);
 
+    // Set the directory to keep hamilton cycles in between runs, which
+    // must exist. Default is empty, which generates a new cycle every run.
+    game->setCycleCacheDir("");
+
+    // Set whether to play a whole game at full speed without drawing,
+    // then print the moves and time taken. Default is false.
+    game->setHeadless(false);
+
     // Set whether to run the test program. Default is false.
     game->setRunTest(false);
 
@@ -0,0 +1,32 @@
+#include "AllocCounter.h"
+#include <cstdlib>
+#include <new>
+
+namespace {
+// Per thread so that the drawing threads don't disturb the count
+thread_local unsigned long allocCount = 0;
+}
+
+unsigned long AllocCounter::getCount() {
+    return allocCount;
+}
+
+void* operator new(std::size_t size) {
+    ++allocCount;
+    if (size == 0) {
+        size = 1;
+    }
+    void *p = std::malloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+/*
+Count the heap allocations made through the global operator new,
+which is replaced in AllocCounter.cpp.
+Linked into alloc_test only, never into the game.
+*/
+class AllocCounter {
+public:
+    /*
+    Get the amount of allocations made by the calling thread.
+    */
+    static unsigned long getCount();
+};
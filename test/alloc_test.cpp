@@ -0,0 +1,49 @@
+#include "AllocCounter.h"
+#include "GameSession.h"
+#include <cstdio>
+
+/*
+Play seeded games to the end and check that no tick allocates memory.
+All the scratch buffers of a game are sized by init(), so this holds
+from the first tick on.
+*/
+
+static int countAllocTicks(const Map::size_type size, const Random::seed_type seed) {
+    GameSession session;
+    session.setMapRow(size);
+    session.setMapCol(size);
+    session.setSeed(seed);
+    session.init();
+
+    long ticks = 0, allocTicks = 0;
+    while (!session.isOver()) {
+        auto cnt = AllocCounter::getCount();
+        session.tick();
+        if (AllocCounter::getCount() != cnt) {
+            if (allocTicks == 0) {
+                fprintf(stderr, "%lu*%lu seed %llu: tick %ld allocated memory\n",
+                        static_cast<unsigned long>(size), static_cast<unsigned long>(size),
+                        static_cast<unsigned long long>(seed), ticks);
+            }
+            ++allocTicks;
+        }
+        ++ticks;
+    }
+    return allocTicks > 0 ? 1 : 0;
+}
+
+int main() {
+    int failures = 0;
+    for (Random::seed_type seed = 1; seed <= 15; ++seed) {
+        failures += countAllocTicks(10, seed);
+    }
+    for (Random::seed_type seed = 1; seed <= 3; ++seed) {
+        failures += countAllocTicks(20, seed);
+    }
+    if (failures > 0) {
+        fprintf(stderr, "%d games allocated in a tick\n", failures);
+        return 1;
+    }
+    printf("No allocation in a tick\n");
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include "BatchEnv.h"
+#include "GameSession.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+/*
+Step a BatchEnv alongside GameSessions started from the same snakes and
+check that every cell, head, length and direction stays the same. The
+sessions draw their food from their own generators, so the food an env
+game places after eating is copied to its session.
+
+The first round lets the AI of the sessions choose the moves. The second
+round moves at random among the safe cells, and sometimes anywhere, so
+that the snakes also die.
+*/
+
+static const Map::size_type SIZE = 12;
+static const BatchEnv::size_type GAMES = 8;
+static const Direc allDirecs[4] = {LEFT, UP, RIGHT, DOWN};
+
+struct Counts {
+    int eats = 0;
+    int deaths = 0;
+    int wins = 0;
+    int timeouts = 0;
+};
+
+static int checkSame(const BatchEnv &env, const BatchEnv::size_type k, const GameSession &session,
+                     const long long move) {
+    const Snake &snake = session.getSnake();
+    const auto &body = snake.getBody();
+    bool same = std::memcmp(env.getCells(k), session.getMap()->getCells(), SIZE * SIZE) == 0
+                && env.getHeads()[k] == body.front()
+                && env.getLengths()[k] == snake.length()
+                && env.getDirections()[k] == snake.getDirection();
+    if (!same) {
+        fprintf(stderr, "game %lu differs after move %lld\n", static_cast<unsigned long>(k), move);
+        return 1;
+    }
+    return 0;
+}
+
+static int playRound(const Random::seed_type firstSeed, const bool useAI, Counts &counts) {
+    BatchEnv env(GAMES, SIZE, SIZE, firstSeed);
+    std::vector<GameSession> sessions(GAMES);
+    std::vector<bool> active(GAMES, true);
+    Random rng(firstSeed);
+
+    for (BatchEnv::size_type k = 0; k < GAMES; ++k) {
+        GameSession &session = sessions[k];
+        session.setMapRow(SIZE);
+        session.setMapCol(SIZE);
+        session.setSeed(firstSeed + k);
+        session.init();
+
+        const auto &body = session.getSnake().getBody();
+        std::vector<BatchEnv::index_type> cells;
+        for (Snake::size_type i = 0; i < body.size(); ++i) {
+            cells.push_back(body[i]);
+        }
+        // The first move of the AI sets the direction of both
+        env.setGame(k, cells, session.getSnake().getDirection(), session.getMap()->getFood());
+        if (checkSame(env, k, session, 0)) {
+            return 1;
+        }
+    }
+
+    std::vector<Direc> actions(GAMES);
+    long long area = static_cast<long long>(SIZE - 2) * (SIZE - 2);
+    int activeCnt = GAMES;
+    for (long long move = 1; activeCnt > 0 && move <= area * area; ++move) {
+        for (BatchEnv::size_type k = 0; k < GAMES; ++k) {
+            actions[k] = NONE;
+            if (!active[k]) {
+                continue;
+            }
+            Snake &snake = sessions[k].getSnake();
+            if (useAI) {
+                snake.decideNext();
+            } else {
+                const Map &map = *sessions[k].getMap();
+                Direc safe[4];
+                int safeCnt = 0;
+                for (Direc d : allDirecs) {
+                    if (map.isSafe(map.getAdj(snake.getBody().front(), d))) {
+                        safe[safeCnt++] = d;
+                    }
+                }
+                if (safeCnt == 0 || rng.below(20) == 0) {
+                    snake.setDirection(allDirecs[rng.below(4)]);
+                } else {
+                    snake.setDirection(safe[rng.below(safeCnt)]);
+                }
+            }
+            actions[k] = snake.getDirection();
+        }
+
+        env.step(actions.data());
+        for (BatchEnv::size_type k = 0; k < GAMES; ++k) {
+            if (!active[k]) {
+                continue;
+            }
+            GameSession &session = sessions[k];
+            session.tick(false);
+
+            // The env has already started a new game when it's done, so
+            // only the way the old one ended is compared
+            auto reward = env.getRewards()[k];
+            bool done = env.getDones()[k] != 0;
+            bool ok = done ? (reward < 0 && session.isDead()) || (reward > 0 && session.isWin())
+                             || (reward == 0 && !session.isOver())
+                           : !session.isOver();
+            if (!ok) {
+                fprintf(stderr, "game %lu ended differently after move %lld\n",
+                        static_cast<unsigned long>(k), move);
+                return 1;
+            }
+            if (done) {
+                counts.deaths += reward < 0;
+                counts.wins += reward > 0;
+                counts.timeouts += reward == 0;
+                active[k] = false;
+                --activeCnt;
+                continue;
+            }
+
+            if (reward > 0) {
+                ++counts.eats;
+                auto map = session.getMap();
+                map->removeFood();
+                map->createFood(env.getFoods()[k]);
+            }
+            if (checkSame(env, k, session, move)) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main() {
+    Counts ai, random;
+    int failures = 0;
+    for (Random::seed_type seed = 1; seed <= 3; ++seed) {
+        failures += playRound(seed * 100, true, ai) + playRound(seed * 100 + 50, false, random);
+    }
+    if (failures > 0) {
+        fprintf(stderr, "%d rounds differ\n", failures);
+        return 1;
+    }
+    if (ai.wins == 0 || random.deaths == 0 || random.eats == 0) {
+        fprintf(stderr, "Too few wins, deaths or foods to compare: %d, %d, %d\n",
+                ai.wins, random.deaths, random.eats);
+        return 1;
+    }
+    printf("Same state in all games: %d foods, %d wins, %d deaths, %d timeouts\n",
+           ai.eats + random.eats, ai.wins + random.wins, ai.deaths + random.deaths,
+           ai.timeouts + random.timeouts);
+    return 0;
+}
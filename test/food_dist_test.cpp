@@ -0,0 +1,116 @@
+#include "Map.h"
+#include <cstdio>
+#include <vector>
+
+/*
+Change the cells of maps at random with the food distance field kept
+and compare it after every change with one computed from scratch, so
+that the repairs of setType() are checked on walls, bodies and test
+marks appearing and disappearing, and on the food moving.
+*/
+
+static const Point::Type cellTypes[] = {
+    Point::Type::EMPTY, Point::Type::EMPTY, Point::Type::EMPTY, Point::Type::WALL,
+    Point::Type::SNAKE_BODY, Point::Type::SNAKE_HEAD, Point::Type::TEST_VISIT
+};
+static const int TYPE_CNT = sizeof(cellTypes) / sizeof(cellTypes[0]);
+
+/*
+Compute the distances to the food by a breadth-first search through the
+free cells and the food.
+*/
+static std::vector<Point::value_type> freshDist(const Map &map) {
+    auto cells = map.getCells();
+    std::vector<Point::value_type> dist(map.getRowCount() * map.getColCount(), INF);
+    if (!map.hasFood()) {
+        return dist;
+    }
+    auto isOpen = [&](Map::index_type i) {
+        return cells[i] == Point::Type::EMPTY || cells[i] == Point::Type::FOOD
+               || cells[i] >= Point::Type::TEST_VISIT;
+    };
+    std::vector<Map::index_type> open(1, map.getFood());
+    dist[map.getFood()] = 0;
+    for (size_t head = 0; head < open.size(); ++head) {
+        auto cur = open[head];
+        for (int d = LEFT; d <= DOWN; ++d) {
+            auto adj = cur + map.getAdjOffset(static_cast<Direc>(d));
+            if (dist[adj] == INF && isOpen(adj)) {
+                dist[adj] = dist[cur] + 1;
+                open.push_back(adj);
+            }
+        }
+    }
+    return dist;
+}
+
+static int checkField(const Map &map, const Random::seed_type seed, const int change) {
+    auto expected = freshDist(map);
+    auto cells = map.getCells();
+    for (Map::index_type i = 0; i < expected.size(); ++i) {
+        bool open = cells[i] == Point::Type::EMPTY || cells[i] >= Point::Type::TEST_VISIT;
+        if (open && map.getFoodDist(i) != expected[i]) {
+            fprintf(stderr, "seed %llu change %d: distance of %s is %d, expected %d\n",
+                    static_cast<unsigned long long>(seed), change, map.toPos(i).toString().c_str(),
+                    map.getFoodDist(i), expected[i]);
+            return 1;
+        }
+        if (!open || expected[i] == INF || expected[i] == 0) {
+            continue;
+        }
+        // The direction must lead one step closer
+        auto adj = map.getAdj(i, map.getFoodDirec(i, NONE));
+        if (expected[adj] != expected[i] - 1) {
+            fprintf(stderr, "seed %llu change %d: direction from %s leads away from the food\n",
+                    static_cast<unsigned long long>(seed), change, map.toPos(i).toString().c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int runChanges(const Map::size_type rows, const Map::size_type cols,
+                      const Random::seed_type seed, const int changes) {
+    Map map(rows, cols);
+    map.setUseFoodDist(true);
+    Random rng(seed);
+    map.createRandFood(rng);
+
+    for (int change = 1; change <= changes; ++change) {
+        if (rng.below(20) == 0) {
+            // Move the food, or leave none for a while
+            map.removeFood();
+            if (rng.below(4) != 0) {
+                map.createRandFood(rng);
+            }
+        } else {
+            Pos p(1 + rng.below(rows - 2), 1 + rng.below(cols - 2));
+            auto i = map.toIndex(p);
+            if (i == map.getFood()) {
+                continue;
+            }
+            map.setType(i, cellTypes[rng.below(TYPE_CNT)]);
+            if (!map.hasFood() && rng.below(4) == 0) {
+                map.createRandFood(rng);
+            }
+        }
+        if (checkField(map, seed, change)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main() {
+    int failures = 0;
+    for (Random::seed_type seed = 1; seed <= 40; ++seed) {
+        failures += runChanges(12, 12, seed, 400);
+        failures += runChanges(9, 23, seed, 400);
+    }
+    if (failures > 0) {
+        fprintf(stderr, "%d runs differ\n", failures);
+        return 1;
+    }
+    printf("Food distances ok\n");
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include "GameSession.h"
+#include <cstdio>
+
+/*
+Play seeded games to the end and check that the AI wins every one.
+The seeds include games the shortcut check used to lose by jumping
+next to the tail.
+*/
+
+static int playGames(const Map::size_type size, const Random::seed_type firstSeed, const int games) {
+    int failures = 0;
+    for (int i = 0; i < games; ++i) {
+        GameSession session;
+        session.setMapRow(size);
+        session.setMapCol(size);
+        session.setSeed(firstSeed + i);
+        session.init();
+
+        long long area = static_cast<long long>(size - 2) * (size - 2);
+        session.play(area * area);
+        if (!session.isWin()) {
+            fprintf(stderr, "%lu*%lu seed %llu: %s after %lld moves\n",
+                    static_cast<unsigned long>(size), static_cast<unsigned long>(size),
+                    static_cast<unsigned long long>(firstSeed + i),
+                    session.isDead() ? "lost" : "timed out", session.getMoveCount());
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+int main() {
+    int failures = playGames(12, 100, 200) + playGames(16, 100, 20);
+    if (failures > 0) {
+        fprintf(stderr, "%d games not won\n", failures);
+        return 1;
+    }
+    printf("All games won\n");
+    return 0;
+}
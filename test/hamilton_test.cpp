@@ -0,0 +1,77 @@
+#include "GameSession.h"
+#include "Hamilton.h"
+#include <cstdio>
+#include <stdexcept>
+
+/*
+Check Hamilton::location() along whole cycles, across the end of the
+sequence in particular, where it must keep counting up by one. The maps
+include odd sizes and the walls of the hard mode, which cut blocks in
+two, so that the cycle must be built around them.
+*/
+
+static int checkLocations(const Map::size_type rows, const Map::size_type cols,
+                          const Random::seed_type seed, const bool hardMode = false) {
+    Map map(rows, cols);
+    if (hardMode) {
+        GameSession::addHardWalls(map);
+    }
+    SearchContext ctx;
+    Random rng(seed);
+    Hamilton ham;
+    try {
+        ham.generate(map, ctx, rng);
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%lu*%lu seed %llu: %s\n", static_cast<unsigned long>(rows),
+                static_cast<unsigned long>(cols), static_cast<unsigned long long>(seed), e.what());
+        return 1;
+    }
+
+    int failures = 0;
+    auto cycleLen = static_cast<Hamilton::location_type>(map.getEmptyCount());
+    for (Map::index_type anchor = 0; anchor < rows * cols; ++anchor) {
+        if (!map.isEmpty(anchor)) {
+            continue;
+        }
+        // Walk once around from the anchor
+        auto start = ham.location(anchor, anchor);
+        auto cur = anchor;
+        bool ordered = true;
+        for (Hamilton::location_type k = 0; k < cycleLen && ordered; ++k) {
+            if (ham.location(anchor, cur) != start + k) {
+                fprintf(stderr, "%lu*%lu seed %llu: location of %s from %s is %u, expected %u\n",
+                        static_cast<unsigned long>(rows), static_cast<unsigned long>(cols),
+                        static_cast<unsigned long long>(seed), map.toPos(cur).toString().c_str(),
+                        map.toPos(anchor).toString().c_str(), ham.location(anchor, cur), start + k);
+                ++failures;
+                ordered = false;
+            }
+            cur = ham.next(cur);
+        }
+        if (ordered && cur != anchor) {
+            fprintf(stderr, "%lu*%lu seed %llu: the cycle from %s isn't %u cells long\n",
+                    static_cast<unsigned long>(rows), static_cast<unsigned long>(cols),
+                    static_cast<unsigned long long>(seed), map.toPos(anchor).toString().c_str(), cycleLen);
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+int main() {
+    int failures = 0;
+    for (Random::seed_type seed = 1; seed <= 20; ++seed) {
+        failures += checkLocations(6, 6, seed);
+        failures += checkLocations(10, 14, seed);
+        failures += checkLocations(9, 12, seed);
+    }
+    for (Random::seed_type seed = 1; seed <= 500; ++seed) {
+        failures += checkLocations(20, 20, seed, true);
+    }
+    if (failures > 0) {
+        fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    printf("Hamilton locations ok\n");
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "Map.h"
+#include "SearchContext.h"
+#include <cstdio>
+#include <vector>
+
+/*
+Search shortest paths on seeded random maps with the BFS, A* and the
+bidirectional search, and check that every path is a walk through
+empty cells to the goal as long as the one a plain breadth-first search
+finds. The goals include the food and body cells, and unreachable ones,
+for which every search must give an empty path.
+*/
+
+static const Map::SearchAlgo algos[] = {Map::BFS, Map::ASTAR, Map::BIBFS};
+static const char *algoNames[] = {"BFS", "ASTAR", "BIBFS"};
+static const Direc allDirecs[4] = {LEFT, UP, RIGHT, DOWN};
+
+/*
+Compute the shortest distance through empty cells, the goal being
+entered from any reached cell.
+*/
+static Point::value_type freshDist(const Map &map, const Map::index_type from,
+                                   const Map::index_type to) {
+    std::vector<Point::value_type> dist(map.getRowCount() * map.getColCount(), INF);
+    std::vector<Map::index_type> open(1, from);
+    dist[from] = 0;
+    for (size_t head = 0; head < open.size(); ++head) {
+        auto cur = open[head];
+        for (Direc d : allDirecs) {
+            auto adj = map.getAdj(cur, d);
+            if (dist[adj] != INF) {
+                continue;
+            }
+            if (adj == to) {
+                return dist[cur] + 1;
+            }
+            if (map.isEmpty(adj)) {
+                dist[adj] = dist[cur] + 1;
+                open.push_back(adj);
+            }
+        }
+    }
+    return INF;
+}
+
+/*
+Check that a path walks from one cell to another through empty cells.
+*/
+static bool isValidWalk(const Map &map, const Map::index_type from, const Map::index_type to,
+                        const Path &path) {
+    auto cur = from;
+    Path::size_type k = 0;
+    for (const auto &d : path) {
+        cur = map.getAdj(cur, d);
+        if (!map.isInside(cur)) {
+            return false;
+        }
+        if (++k < path.size() && !map.isEmpty(cur)) {
+            return false;
+        }
+    }
+    return cur == to;
+}
+
+static int checkMap(const Map::size_type rows, const Map::size_type cols,
+                    const Random::seed_type seed, const bool useBitboard) {
+    Map map(rows, cols);
+    Random rng(seed);
+    auto area = (rows - 2) * (cols - 2);
+    auto blocked = area * (10 + rng.below(30)) / 100;
+    for (Map::size_type k = 0; k < blocked; ++k) {
+        auto i = map.randomEmpty(rng);
+        map.setType(i, rng.below(2) == 0 ? Point::Type::WALL : Point::Type::SNAKE_BODY);
+    }
+    map.createRandFood(rng);
+    map.setUseBitboard(useBitboard);
+
+    SearchContext ctx;
+    Path path;
+    int failures = 0;
+    for (int query = 0; query < 40; ++query) {
+        auto from = map.randomEmpty(rng);
+        Map::index_type to;
+        do {
+            to = map.toIndex(Pos(1 + rng.below(rows - 2), 1 + rng.below(cols - 2)));
+        } while (to == from || map.getType(to) == Point::Type::WALL);
+        auto expected = freshDist(map, from, to);
+        Direc initDirec = allDirecs[rng.below(4)];
+
+        for (int a = 0; a < 3; ++a) {
+            map.findMinPath(from, to, initDirec, ctx, path, algos[a]);
+            bool ok = expected == INF ? path.empty()
+                                      : static_cast<Point::value_type>(path.size()) == expected
+                                        && isValidWalk(map, from, to, path);
+            if (!ok) {
+                fprintf(stderr, "%lu*%lu seed %llu: %s path from %s to %s has %lu steps, expected %d\n",
+                        static_cast<unsigned long>(rows), static_cast<unsigned long>(cols),
+                        static_cast<unsigned long long>(seed), algoNames[a],
+                        map.toPos(from).toString().c_str(), map.toPos(to).toString().c_str(),
+                        static_cast<unsigned long>(path.size()), expected);
+                ++failures;
+            }
+        }
+    }
+    return failures;
+}
+
+int main() {
+    int failures = 0;
+    for (Random::seed_type seed = 1; seed <= 60; ++seed) {
+        failures += checkMap(12, 12, seed, seed % 2 == 0);
+        failures += checkMap(9, 31, seed, seed % 2 == 1);
+    }
+    if (failures > 0) {
+        fprintf(stderr, "%d paths differ\n", failures);
+        return 1;
+    }
+    printf("Shortest paths ok\n");
+    return 0;
+}